@@ -0,0 +1,119 @@
+#pragma once
+
+#include "common/generate.cpp"
+#include "common/parse.cpp"
+#include "solve.cpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Skip sizes whose distance matrix would not fit in this many bytes
+#define BENCH_MAX_MATRIX_BYTES (8ull << 30)
+
+struct bench_result_t {
+    unsigned int runs;
+    double wall_ms;
+    long peak_rss_kb;
+    total_cost_t best_cost;
+    double avg_cost;
+};
+
+// Solve the instance in a forked child, so the peak RSS reported by wait4
+// belongs to this case alone. Returns false if the child failed.
+bool bench_case(const std::vector<node_t> &nodes, heuristic_t heuristic,
+                bench_result_t &result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        timer_t timer;
+        timer.start();
+
+        tsp_t tsp(nodes, matrixof(nodes));
+        stats_sink_t stats;
+        solve(tsp, heuristic, stats);
+
+        bench_result_t child = {unsigned(stats.costs.count), 0, 0, INT64_MAX,
+                                stats.costs.mean};
+        if (stats.costs.count > 0) {
+            child.best_cost = stats.costs.min;
+        }
+        child.wall_ms = timer.measure_ms();
+
+        bool ok = write(fds[1], &child, sizeof(child)) == sizeof(child);
+        close(fds[1]);
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage = {};
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        return false;
+    }
+
+    result.peak_rss_kb = usage.ru_maxrss;
+    return ok;
+}
+
+// Run every heuristic on a generated instance of every size and write one
+// CSV row per case. Instances depend only on the seed and size.
+int bench(const std::vector<unsigned int> &sizes,
+          const std::vector<heuristic_t> &heuristics, layout_t layout,
+          weight_dist_t weights, std::ostream &os) {
+    os << "layout,n,heuristic,runs,wall_ms,peak_rss_kb,best_cost,avg_cost"
+       << std::endl;
+
+    for (unsigned int n : sizes) {
+        rng_stream(n);
+        std::vector<node_t> nodes = generate_nodes(n, layout, weights);
+        if (matrix_bytes(nodes) > BENCH_MAX_MATRIX_BYTES) {
+            std::cerr << "Skipping n=" << n
+                      << ": distance matrix exceeds the memory limit"
+                      << std::endl;
+            continue;
+        }
+
+        for (heuristic_t heuristic : heuristics) {
+            std::cerr << "Running " << heuristic_t_str[heuristic]
+                      << " on n=" << n << std::endl;
+
+            bench_result_t result = {};
+            if (!bench_case(nodes, heuristic, result)) {
+                std::cerr << heuristic_t_str[heuristic] << " failed on n=" << n
+                          << std::endl;
+                return 1;
+            }
+
+            os << layout_t_str[layout] << "," << n << ","
+               << heuristic_t_str[heuristic] << "," << result.runs << ","
+               << result.wall_ms << "," << result.peak_rss_kb << ","
+               << result.best_cost << "," << result.avg_cost << std::endl;
+        }
+    }
+
+    return 0;
+}
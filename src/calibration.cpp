@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common/types.cpp"
+
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// FNV-1a over the nodes, identifies an instance regardless of its file name
+uint64_t instance_hash(const tsp_t &tsp) {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&](int value) {
+        for (unsigned int i = 0; i < sizeof(value); i++) {
+            hash = (hash ^ ((uint32_t(value) >> (8 * i)) & 0xff)) *
+                   0x100000001b3;
+        }
+    };
+    // Integral coordinates hash as the int they used to be, so the cached
+    // limits of the CSV instances stay valid
+    auto mix_coord = [&](double value) {
+        if (std::trunc(value) == value && std::abs(value) <= INT_MAX) {
+            mix(int(value));
+            return;
+        }
+        uint64_t bits = std::bit_cast<uint64_t>(value);
+        mix(int(uint32_t(bits)));
+        mix(int(uint32_t(bits >> 32)));
+    };
+    for (const node_t &node : tsp.nodes) {
+        mix_coord(node.x);
+        mix_coord(node.y);
+        mix(node.weight);
+    }
+    return hash;
+}
+
+// Calibrated time limits of earlier invocations, a CSV of
+// hash,instance,n,time_limit_ms. New calibrations are appended as they are
+// made; delete the file to calibrate again (e.g. on another machine).
+struct calibration_cache_t {
+    std::string path;
+    std::mutex mutex;
+    std::map<uint64_t, int> limits;
+
+    calibration_cache_t(const std::string &path) : path(path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line); // Header
+        while (std::getline(in, line)) {
+            std::stringstream ss(line);
+            std::string hash, name, n, ms;
+            if (std::getline(ss, hash, ',') && std::getline(ss, name, ',') &&
+                std::getline(ss, n, ',') && std::getline(ss, ms)) {
+                try {
+                    limits[std::stoull(hash, nullptr, 16)] = std::stoi(ms);
+                } catch (const std::exception &) {
+                    // Skip a damaged line, it is calibrated again
+                }
+            }
+        }
+    }
+
+    std::optional<int> find(uint64_t hash) {
+        std::lock_guard lock(mutex);
+        auto found = limits.find(hash);
+        if (found == limits.end()) {
+            return {};
+        }
+        return found->second;
+    }
+
+    void store(uint64_t hash, const std::string &name, unsigned int n,
+               int time_limit_ms) {
+        std::lock_guard lock(mutex);
+        limits[hash] = time_limit_ms;
+
+        bool fresh = !std::ifstream(path).good();
+        std::ofstream out(path, std::ios::app);
+        if (fresh) {
+            out << "hash,instance,n,time_limit_ms" << std::endl;
+        }
+        out << std::hex << hash << std::dec << "," << name << "," << n << ","
+            << time_limit_ms << std::endl;
+    }
+};
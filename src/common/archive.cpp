@@ -0,0 +1,172 @@
+#pragma once
+
+#include "counters.cpp"
+#include "edges.cpp"
+#include "random.cpp"
+#include "types.cpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define ARCHIVE_BANDS 8 // LSH bands, a candidate has to match one of them
+#define ARCHIVE_ROWS 4  // MinHash values per band
+#define ARCHIVE_HASHES (ARCHIVE_BANDS * ARCHIVE_ROWS)
+
+typedef std::array<uint64_t, ARCHIVE_HASHES> minhash_t;
+
+// MinHash signature of an edge set. Two sets agree on each value with
+// probability equal to their Jaccard similarity.
+minhash_t minhash(const std::vector<uint64_t> &edges) {
+    minhash_t signature;
+    signature.fill(UINT64_MAX);
+    for (uint64_t edge : edges) {
+        uint64_t x = edge;
+        for (uint64_t &value : signature) {
+            value = std::min(value, splitmix64(x));
+        }
+    }
+    return signature;
+}
+
+// A solution reduced to what similarity queries need
+struct archive_key_t {
+    std::vector<uint64_t> edges;
+    minhash_t signature;
+
+    archive_key_t(const solution_t &sol)
+        : edges(packed_edges(sol)), signature(minhash(edges)) {}
+};
+
+struct archive_match_t {
+    unsigned int id;
+    unsigned int common_edges;
+};
+
+// Elite archive of at most `capacity` solutions, the worst one is evicted
+// to make room. Similarity queries only compare against the solutions that
+// share an LSH band (ARCHIVE_ROWS MinHash values in a row) with the query,
+// so they stay sub-linear in the archive size; similar solutions are found
+// with high probability, dissimilar ones are rarely even looked at.
+struct archive_t {
+    struct entry_t {
+        archive_key_t key;
+        total_cost_t cost;
+        unsigned int tag; // Caller's handle, e.g. a population index
+    };
+
+    unsigned int capacity;
+    std::vector<std::optional<entry_t>> entries; // By id, empty when removed
+    std::vector<unsigned int> free_ids;
+    std::set<std::pair<total_cost_t, unsigned int>> by_cost; // (cost, id)
+    std::array<std::unordered_map<uint64_t, std::vector<unsigned int>>,
+               ARCHIVE_BANDS>
+        buckets;
+
+    archive_t(unsigned int capacity) : capacity(capacity) {}
+
+    unsigned int size() const { return by_cost.size(); }
+
+    const entry_t &operator[](unsigned int id) const {
+        return entries[id].value();
+    }
+
+    // Returns the id of the new entry
+    unsigned int insert(archive_key_t key, total_cost_t cost,
+                        unsigned int tag = 0) {
+        if (size() >= capacity) {
+            remove(std::prev(by_cost.end())->second);
+        }
+
+        unsigned int id = entries.size();
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+        } else {
+            entries.emplace_back();
+        }
+
+        for (unsigned int band = 0; band < ARCHIVE_BANDS; band++) {
+            buckets[band][band_hash(key.signature, band)].push_back(id);
+        }
+        by_cost.insert({cost, id});
+        entries[id].emplace(entry_t{std::move(key), cost, tag});
+        return id;
+    }
+
+    void remove(unsigned int id) {
+        const entry_t &entry = entries[id].value();
+        for (unsigned int band = 0; band < ARCHIVE_BANDS; band++) {
+            auto bucket = buckets[band].find(band_hash(entry.key.signature,
+                                                       band));
+            std::vector<unsigned int> &ids = bucket->second;
+            ids.erase(std::find(ids.begin(), ids.end(), id));
+            if (ids.empty()) {
+                buckets[band].erase(bucket);
+            }
+        }
+        by_cost.erase({entry.cost, id});
+        entries[id].reset();
+        free_ids.push_back(id);
+    }
+
+    // Up to k archived solutions most similar to the key (by common
+    // edges), most similar first. Approximate: only LSH candidates count.
+    std::vector<archive_match_t> similar(const archive_key_t &key,
+                                         unsigned int k) const {
+        STAT(ARCHIVE_QUERIES);
+        std::vector<unsigned int> candidates;
+        for (unsigned int band = 0; band < ARCHIVE_BANDS; band++) {
+            auto bucket = buckets[band].find(band_hash(key.signature, band));
+            if (bucket != buckets[band].end()) {
+                candidates.insert(candidates.end(), bucket->second.begin(),
+                                  bucket->second.end());
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+        STAT_ADD(ARCHIVE_CANDIDATES, candidates.size());
+
+        std::vector<archive_match_t> matches;
+        matches.reserve(candidates.size());
+        for (unsigned int id : candidates) {
+            matches.push_back(
+                {id, common_edges(key.edges, (*this)[id].key.edges)});
+        }
+
+        k = std::min<size_t>(k, matches.size());
+        std::partial_sort(matches.begin(), matches.begin() + k, matches.end(),
+                          [](const archive_match_t &a,
+                             const archive_match_t &b) {
+                              return a.common_edges > b.common_edges ||
+                                     (a.common_edges == b.common_edges &&
+                                      a.id < b.id);
+                          });
+        matches.resize(k);
+        return matches;
+    }
+
+    std::optional<archive_match_t> nearest(const archive_key_t &key) const {
+        std::vector<archive_match_t> matches = similar(key, 1);
+        if (matches.empty()) {
+            return {};
+        }
+        return matches.front();
+    }
+
+  private:
+    static uint64_t band_hash(const minhash_t &signature, unsigned int band) {
+        uint64_t hash = band;
+        for (unsigned int row = 0; row < ARCHIVE_ROWS; row++) {
+            hash ^= signature[band * ARCHIVE_ROWS + row];
+            hash = splitmix64(hash);
+        }
+        return hash;
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "random.cpp"
+#include "trace.cpp"
+#include "types.cpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#define CHECKPOINT_EVERY_MS 5000 // Period between saves of the running best
+
+// Resume hooks of the run on the calling thread. The time-bounded
+// metaheuristics start from the saved best of an interrupted run, if any,
+// and hand their current best to `save` now and then (see: experiment).
+// Both are off outside of experiments.
+struct checkpoint_t {
+    std::function<void(const solution_t &best, const rng_t &rng)> save;
+    std::optional<solution_t> warm;
+    rng_t warm_rng;
+    int64_t last_ns = 0;
+};
+
+inline checkpoint_t &checkpoint() {
+    thread_local checkpoint_t state;
+    return state;
+}
+
+// Starting solution of a metaheuristic: the saved best, continuing the
+// random stream where the interrupted run left it, otherwise make()
+template <typename make_t> solution_t warm_start_or(make_t &&make) {
+    checkpoint_t &state = checkpoint();
+    if (!state.warm.has_value()) {
+        return make();
+    }
+
+    rng() = state.warm_rng;
+    solution_t solution = std::move(state.warm.value());
+    state.warm.reset();
+    return solution;
+}
+
+// Called once per iteration with the best solution so far
+inline void checkpoint_best(const solution_t &best) {
+    checkpoint_t &state = checkpoint();
+    if (!state.save) {
+        return;
+    }
+
+    int64_t now = now_ns();
+    if (now - state.last_ns < int64_t(CHECKPOINT_EVERY_MS) * 1000000) {
+        return;
+    }
+    state.last_ns = now;
+    state.save(best, rng());
+}
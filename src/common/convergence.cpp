@@ -0,0 +1,110 @@
+#pragma once
+
+#include "profile.cpp"
+#include "types.cpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#define CONVERGENCE_CAPACITY 4096 // Samples per run before thinning out
+#define CONVERGENCE_EVERY 100     // Initial sample period
+
+// Traces are only kept when enabled (see: experiment)
+bool convergence_enabled = false;
+
+struct convergence_point_t {
+    int64_t elapsed_ns;
+    unsigned int iter;
+    total_cost_t cost;
+    total_cost_t best;
+    bool improved;
+};
+
+// Anytime trace of one run of a time-bounded metaheuristic. Samples every
+// improvement of the best cost plus every `period`-th iteration into a
+// buffer allocated up front. Once it is full the periodic samples are
+// thinned out (every other one dropped, the period doubled) to make room;
+// improvements are always kept, even past the capacity. Written by the
+// owning thread only, so no locking.
+struct convergence_t {
+    std::vector<convergence_point_t> samples;
+    unsigned int period;
+    int64_t start_ns;
+    total_cost_t best;
+
+    convergence_t() : samples(), period(CONVERGENCE_EVERY), start_ns(now_ns()),
+                      best(INT64_MAX) {
+        if (convergence_enabled) {
+            samples.reserve(CONVERGENCE_CAPACITY);
+        }
+    }
+
+    bool enabled() const { return samples.capacity() > 0; }
+
+    void record(unsigned int iter, total_cost_t cost) {
+        if (!enabled()) {
+            return;
+        }
+
+        bool improved = cost < best;
+        if (improved) {
+            best = cost;
+        } else if (iter % period != 0 || !make_room(iter)) {
+            return;
+        }
+
+        samples.push_back({now_ns() - start_ns, iter, cost, best, improved});
+    }
+
+    // Samples in recording order
+    const std::vector<convergence_point_t> &points() const { return samples; }
+
+  private:
+    // Whether the periodic sample of `iter` still fits, thinning out the
+    // older ones if needed. Gives up once a pass frees nothing: what is left
+    // are improvements and samples of iteration 0 (e.g. the initial
+    // population of HEA), which no period thins out.
+    bool make_room(unsigned int iter) {
+        while (samples.size() >= CONVERGENCE_CAPACITY) {
+            if (period > UINT_MAX / 2) {
+                return false;
+            }
+            period *= 2;
+            size_t size = samples.size();
+            std::erase_if(samples, [&](const convergence_point_t &p) {
+                return !p.improved && p.iter % period != 0;
+            });
+            if (samples.size() == size) {
+                return false;
+            }
+        }
+        return iter % period == 0;
+    }
+};
+
+// Finished traces of the calling thread, in run order
+inline std::vector<convergence_t> &convergence_log() {
+    thread_local std::vector<convergence_t> log;
+    return log;
+}
+
+inline void finish_trace(convergence_t &trace) {
+    if (trace.enabled()) {
+        convergence_log().push_back(std::move(trace));
+    }
+}
+
+void write_convergence(std::ostream &os,
+                       const std::vector<convergence_t> &traces) {
+    os << "run,elapsed_ns,iter,cost,best" << std::endl;
+    for (unsigned int run = 0; run < traces.size(); run++) {
+        for (const convergence_point_t &p : traces[run].points()) {
+            os << run << "," << p.elapsed_ns << "," << p.iter << "," << p.cost
+               << "," << p.best << "\n";
+        }
+    }
+}
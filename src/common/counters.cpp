@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Hot-path event counters. They are compiled in only with -DTSP_STATS,
+// otherwise STAT expands to nothing and the counters stay at zero.
+enum counter_t {
+    DELTA_INSERT,
+    DELTA_REMOVE,
+    DELTA_REPLACE,
+    DELTA_SWAP,
+    DELTA_REVERSE,
+    MOVE_APPEND,
+    MOVE_PREPEND,
+    MOVE_INSERT,
+    MOVE_REMOVE,
+    MOVE_REPLACE,
+    MOVE_SWAP,
+    MOVE_REVERSE,
+    QUEUE_HITS,
+    QUEUE_STALE,
+    DLB_ACTIVATIONS,
+    CHILDREN,
+    CHILDREN_ACCEPTED,
+    SOLUTION_ALLOCS,
+    ARCHIVE_QUERIES,
+    ARCHIVE_CANDIDATES,
+    BASIN_REVISITS,
+    COUNTER_COUNT
+};
+
+std::map<counter_t, std::string> counter_t_str = {
+    {DELTA_INSERT, "delta_insert"},
+    {DELTA_REMOVE, "delta_remove"},
+    {DELTA_REPLACE, "delta_replace"},
+    {DELTA_SWAP, "delta_swap"},
+    {DELTA_REVERSE, "delta_reverse"},
+    {MOVE_APPEND, "move_append"},
+    {MOVE_PREPEND, "move_prepend"},
+    {MOVE_INSERT, "move_insert"},
+    {MOVE_REMOVE, "move_remove"},
+    {MOVE_REPLACE, "move_replace"},
+    {MOVE_SWAP, "move_swap"},
+    {MOVE_REVERSE, "move_reverse"},
+    {QUEUE_HITS, "queue_hits"},
+    {QUEUE_STALE, "queue_stale"},
+    {DLB_ACTIVATIONS, "dlb_activations"},
+    {CHILDREN, "children"},
+    {CHILDREN_ACCEPTED, "children_accepted"},
+    {SOLUTION_ALLOCS, "solution_allocs"},
+    {ARCHIVE_QUERIES, "archive_queries"},
+    {ARCHIVE_CANDIDATES, "archive_candidates"},
+    {BASIN_REVISITS, "basin_revisits"}};
+
+typedef std::array<uint64_t, COUNTER_COUNT> counter_values_t;
+
+// Counters of every run, by instance and heuristic name
+typedef std::map<std::string, std::map<std::string, counter_values_t>>
+    run_stats_t;
+
+#ifdef TSP_STATS
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+// Counters of one thread, on their own cache lines. Only the owning thread
+// writes, so relaxed load + store is enough and readers never tear a value.
+struct alignas(64) counter_block_t {
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> values = {};
+
+    void add(counter_t counter, uint64_t n) {
+        std::atomic<uint64_t> &value = values[counter];
+        value.store(value.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+};
+
+// Blocks of all threads that ever counted. They are never freed, so the
+// totals survive the threads that produced them.
+struct counter_registry_t {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<counter_block_t>> blocks;
+
+    counter_block_t *add_block() {
+        std::lock_guard lock(mutex);
+        blocks.push_back(std::make_unique<counter_block_t>());
+        return blocks.back().get();
+    }
+
+    counter_values_t total() {
+        std::lock_guard lock(mutex);
+        counter_values_t sum = {};
+        for (const auto &block : blocks) {
+            for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+                sum[i] += block->values[i].load(std::memory_order_relaxed);
+            }
+        }
+        return sum;
+    }
+};
+
+inline counter_registry_t &counter_registry() {
+    static counter_registry_t registry;
+    return registry;
+}
+
+inline counter_block_t &counters() {
+    thread_local counter_block_t *block = counter_registry().add_block();
+    return *block;
+}
+
+// Counters of the calling thread alone, for attributing work to the jobs
+// it runs
+inline counter_values_t thread_counters_snapshot() {
+    counter_values_t values = {};
+    for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+        values[i] = counters().values[i].load(std::memory_order_relaxed);
+    }
+    return values;
+}
+
+// Totals over all threads. Runs take the difference of two snapshots (see:
+// profile_snapshot).
+inline counter_values_t counters_snapshot() {
+    return counter_registry().total();
+}
+
+inline counter_values_t counters_since(const counter_values_t &start) {
+    counter_values_t values = counters_snapshot();
+    for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+        values[i] -= start[i];
+    }
+    return values;
+}
+
+#ifdef TSP_STATS
+#define STAT_ADD(counter, n) counters().add(counter, n)
+#else
+#define STAT_ADD(counter, n) ((void)0)
+#endif
+#define STAT(counter) STAT_ADD(counter, 1)
+
+// Member that counts the constructions and copies of its owner
+struct alloc_counter_t {
+    alloc_counter_t() { STAT(SOLUTION_ALLOCS); }
+    alloc_counter_t(const alloc_counter_t &) { STAT(SOLUTION_ALLOCS); }
+    alloc_counter_t(alloc_counter_t &&) noexcept = default;
+    alloc_counter_t &operator=(const alloc_counter_t &) {
+        STAT(SOLUTION_ALLOCS);
+        return *this;
+    }
+    alloc_counter_t &operator=(alloc_counter_t &&) noexcept = default;
+};
+
+// JSON object with every counter and the derived recombination acceptance
+// rate
+void write_counters_json(std::ostream &os, const counter_values_t &values,
+                         const std::string &indent = "") {
+    os << "{" << std::endl;
+    os << indent << "  \"enabled\": " << (stats_enabled ? "true" : "false");
+    for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+        os << "," << std::endl
+           << indent << "  \"" << counter_t_str[counter_t(i)]
+           << "\": " << values[i];
+    }
+
+    double accept_rate =
+        values[CHILDREN] > 0
+            ? double(values[CHILDREN_ACCEPTED]) / values[CHILDREN]
+            : 0.0;
+    os << "," << std::endl
+       << indent << "  \"children_accept_rate\": " << accept_rate << std::endl;
+    os << indent << "}";
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "types.cpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Undirected edge packed as (min << 32) | max
+inline uint64_t pack_edge(uint64_t a, uint64_t b) {
+    return std::min(a, b) << 32 | std::max(a, b);
+}
+
+// Edges of the cycle, packed and sorted
+std::vector<uint64_t> packed_edges(const solution_t &sol) {
+    std::vector<uint64_t> edges;
+    edges.reserve(sol.path.size());
+    for (unsigned int i = 0; i < sol.path.size(); i++) {
+        edges.push_back(pack_edge(sol.path[i], sol.path[sol.next(i)]));
+    }
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+// Common edges of two sorted edge lists, merged in one pass. An edge
+// repeated in both (the two edges of a 2-node cycle) counts once per
+// matching pair, as comparing the edges one by one would.
+unsigned int common_edges(const std::vector<uint64_t> &a,
+                          const std::vector<uint64_t> &b) {
+    unsigned int common = 0;
+    unsigned int i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            uint64_t edge = a[i];
+            unsigned int run_a = 0, run_b = 0;
+            for (; i < a.size() && a[i] == edge; i++) {
+                run_a++;
+            }
+            for (; j < b.size() && b[j] == edge; j++) {
+                run_b++;
+            }
+            common += run_a * run_b;
+        }
+    }
+    return common;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "random.cpp"
+#include "types.cpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#define GEN_BASE_SIZE 200       // Size of the reference instances
+#define GEN_BASE_WIDTH 4000.0   // Width of the reference instances
+#define GEN_CLUSTER_SIZE 50     // Average number of nodes per cluster
+#define GEN_CLUSTER_SPREAD 0.02 // Cluster std dev, as a fraction of width
+#define GEN_MAX_WEIGHT 2000
+
+enum layout_t { UNIFORM, CLUSTERED, GRID };
+
+std::map<layout_t, std::string> layout_t_str = {
+    {UNIFORM, "uniform"}, {CLUSTERED, "clustered"}, {GRID, "grid"}};
+
+enum weight_dist_t { WEIGHT_UNIFORM, WEIGHT_NORMAL, WEIGHT_EXP, WEIGHT_ZERO };
+
+std::map<weight_dist_t, std::string> weight_dist_t_str = {
+    {WEIGHT_UNIFORM, "uniform"},
+    {WEIGHT_NORMAL, "normal"},
+    {WEIGHT_EXP, "exponential"},
+    {WEIGHT_ZERO, "zero"}};
+
+int gen_weight(weight_dist_t dist) {
+    switch (dist) {
+    case WEIGHT_UNIFORM:
+        return random_num(0, GEN_MAX_WEIGHT);
+    case WEIGHT_NORMAL: {
+        std::normal_distribution<double> normal(GEN_MAX_WEIGHT / 2.0,
+                                                GEN_MAX_WEIGHT / 6.0);
+        return std::clamp(int(normal(rng())), 0, GEN_MAX_WEIGHT);
+    }
+    case WEIGHT_EXP: {
+        std::exponential_distribution<double> exp(4.0 / GEN_MAX_WEIGHT);
+        return std::min(int(exp(rng())), GEN_MAX_WEIGHT);
+    }
+    case WEIGHT_ZERO:
+        return 0;
+    }
+    return 0;
+}
+
+// Random instance of n nodes on a 2:1 rectangle, scaled with sqrt(n) so the
+// node density matches the reference 200-node instances
+std::vector<node_t> generate_nodes(unsigned int n, layout_t layout,
+                                   weight_dist_t weights) {
+    double width = GEN_BASE_WIDTH * std::sqrt(double(n) / GEN_BASE_SIZE);
+    double height = width / 2;
+    std::vector<node_t> nodes(n);
+
+    auto clamp_x = [&](double x) { return int(std::clamp(x, 0.0, width)); };
+    auto clamp_y = [&](double y) { return int(std::clamp(y, 0.0, height)); };
+
+    switch (layout) {
+    case UNIFORM:
+        for (node_t &node : nodes) {
+            node.x = clamp_x(random_real() * width);
+            node.y = clamp_y(random_real() * height);
+        }
+        break;
+    case CLUSTERED: {
+        unsigned int k = std::max(1u, n / GEN_CLUSTER_SIZE);
+        std::vector<std::pair<double, double>> centers(k);
+        for (auto &[x, y] : centers) {
+            x = random_real() * width;
+            y = random_real() * height;
+        }
+
+        std::normal_distribution<double> spread(0,
+                                                GEN_CLUSTER_SPREAD * width);
+        for (node_t &node : nodes) {
+            auto [x, y] = centers[random_below(k)];
+            node.x = clamp_x(x + spread(rng()));
+            node.y = clamp_y(y + spread(rng()));
+        }
+        break;
+    }
+    case GRID: {
+        // Lattice with cols = 2 * rows, filled row by row
+        unsigned int rows = std::max(1.0, std::ceil(std::sqrt(n / 2.0)));
+        unsigned int cols = (n + rows - 1) / rows;
+        double step = width / cols;
+        for (unsigned int i = 0; i < n; i++) {
+            nodes[i].x = clamp_x((i % cols + 0.5) * step);
+            nodes[i].y = clamp_y((i / cols + 0.5) * step);
+        }
+        break;
+    }
+    }
+
+    for (node_t &node : nodes) {
+        node.weight = gen_weight(weights);
+    }
+
+    return nodes;
+}
+
+// Write nodes in the x;y;weight format read by parse
+void write_nodes(std::ostream &os, const std::vector<node_t> &nodes) {
+    std::streamsize precision = os.precision(15); // Whole large coordinates
+    for (const node_t &node : nodes) {
+        os << node.x << ";" << node.y << ";" << node.weight << "\n";
+    }
+    os.precision(precision);
+}
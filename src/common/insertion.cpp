@@ -0,0 +1,166 @@
+#pragma once
+
+#include "types.cpp"
+
+#include <climits>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Cheapest insertion driven by a priority queue of slots. A slot is the gap
+// after a node on the tour (or before the head of an open path) and keeps
+// one entry with its best remaining candidate. Inserting a node only
+// replaces one slot with two, so each step rescores two slots; entries whose
+// candidate has already been inserted are rescored lazily when popped.
+//
+// cost(a, node, b) is the cost delta of putting node between a and b, where
+// a or b is NONE at the ends of an open path.
+template <typename cost_fn_t> struct cheapest_insertion_t {
+    static constexpr unsigned int NONE = UINT_MAX;
+
+    struct entry_t {
+        int delta;
+        unsigned int slot;
+        unsigned int node;
+        unsigned int version;
+
+        bool operator>(const entry_t &other) const {
+            return delta > other.delta;
+        }
+    };
+
+    unsigned int n;
+    cost_fn_t cost;
+    bool open;
+    unsigned int head;
+    std::vector<unsigned int> succ;
+    std::vector<unsigned int> version;
+    std::vector<unsigned int> remaining;
+    std::vector<unsigned int> remaining_idx;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>>
+        queue;
+
+    // Start from `path`, a cycle or (if open) a path with free ends
+    cheapest_insertion_t(const tsp_t &tsp,
+                         const std::vector<unsigned int> &path, cost_fn_t cost,
+                         bool open)
+        : n(tsp.n), cost(cost), open(open), head(path.front()),
+          succ(tsp.n, NONE), version(tsp.n + 1, 0), remaining(),
+          remaining_idx(tsp.n, NONE), queue() {
+        for (unsigned int i = 0; i + 1 < path.size(); i++) {
+            succ[path[i]] = path[i + 1];
+        }
+        succ[path.back()] = open ? NONE : path.front();
+
+        std::vector<bool> in_path(tsp.n, false);
+        for (unsigned int node : path) {
+            in_path[node] = true;
+        }
+        for (unsigned int node = 0; node < tsp.n; node++) {
+            if (!in_path[node]) {
+                remaining_idx[node] = remaining.size();
+                remaining.push_back(node);
+            }
+        }
+
+        for (unsigned int node : path) {
+            rescore(node);
+        }
+        if (open) {
+            rescore(n);
+        }
+    }
+
+    unsigned int slot_from(unsigned int slot) const {
+        return slot == n ? NONE : slot;
+    }
+
+    unsigned int slot_to(unsigned int slot) const {
+        return slot == n ? head : succ[slot];
+    }
+
+    void rescore(unsigned int slot) {
+        if (remaining.empty()) {
+            return;
+        }
+
+        unsigned int a = slot_from(slot), b = slot_to(slot);
+        entry_t best{INT_MAX, slot, NONE, version[slot]};
+
+        for (unsigned int node : remaining) {
+            int delta = cost(a, node, b);
+            if (delta < best.delta) {
+                best.delta = delta;
+                best.node = node;
+            }
+        }
+
+        queue.push(best);
+    }
+
+    // Insert the globally cheapest (slot, node) pair
+    void step() {
+        while (!queue.empty()) {
+            entry_t top = queue.top();
+            queue.pop();
+
+            if (top.version != version[top.slot]) {
+                continue;
+            }
+
+            if (remaining_idx[top.node] == NONE) {
+                rescore(top.slot);
+                continue;
+            }
+
+            insert(top.node, top.slot);
+            return;
+        }
+    }
+
+    void insert(unsigned int node, unsigned int slot) {
+        unsigned int idx = remaining_idx[node];
+        remaining_idx[remaining.back()] = idx;
+        remaining[idx] = remaining.back();
+        remaining.pop_back();
+        remaining_idx[node] = NONE;
+
+        succ[node] = slot_to(slot);
+        if (slot == n) {
+            head = node;
+        } else {
+            succ[slot] = node;
+        }
+
+        version[slot]++;
+        rescore(slot);
+        rescore(node);
+    }
+
+    std::vector<unsigned int> path() const {
+        std::vector<unsigned int> result;
+        unsigned int node = head;
+        do {
+            result.push_back(node);
+            node = succ[node];
+        } while (node != NONE && node != head);
+
+        return result;
+    }
+};
+
+// Grow `path` by cheapest insertion until it holds `size` nodes
+template <typename cost_fn_t>
+std::vector<unsigned int> cheapest_insertion(const tsp_t &tsp,
+                                             std::vector<unsigned int> path,
+                                             unsigned int size,
+                                             cost_fn_t cost, bool open) {
+    cheapest_insertion_t<cost_fn_t> engine(tsp, path, cost, open);
+
+    for (unsigned int i = path.size(); i < size && !engine.remaining.empty();
+         i++) {
+        engine.step();
+    }
+
+    return engine.path();
+}
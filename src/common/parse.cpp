@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -12,16 +15,47 @@ int l2(const node_t a, const node_t b) {
     return int(round(sqrt(pow(b.x - a.x, 2) + pow(b.y - a.y, 2))));
 }
 
-adj_matrix_t matrixof(const std::vector<node_t> nodes) {
-    adj_matrix_t matrix(nodes.size());
+#define MATRIX_TRIANGULAR_NODES 4096 // From here on store one triangle only
 
-    for (unsigned int i = 0; i < nodes.size(); i++) {
-        for (unsigned int j = 0; j < nodes.size(); j++) {
-            if (i == j) {
-                continue;
-            }
+// Longest possible distance between the nodes, the diagonal of their
+// bounding box. Picks the cell type of the matrix without a pass over it.
+int max_distance_bound(const std::vector<node_t> &nodes) {
+    if (nodes.empty()) {
+        return 0;
+    }
+
+    node_t lo = nodes[0], hi = nodes[0];
+    for (const node_t &node : nodes) {
+        lo.x = std::min(lo.x, node.x);
+        lo.y = std::min(lo.y, node.y);
+        hi.x = std::max(hi.x, node.x);
+        hi.y = std::max(hi.y, node.y);
+    }
+    return l2(lo, hi);
+}
+
+bool triangular_matrix(unsigned int n) { return n >= MATRIX_TRIANGULAR_NODES; }
+
+// Memory the distance and arrival matrices of the nodes take (see: matrixof,
+// arrival_matrix_t)
+size_t matrix_bytes(const std::vector<node_t> &nodes) {
+    size_t n = nodes.size();
+    size_t bytes = adj_matrix_t::bytes(n, max_distance_bound(nodes),
+                                       triangular_matrix(n));
+    if (arrival_matrix_t::fits(n)) {
+        bytes += arrival_matrix_t::bytes(n);
+    }
+    return bytes;
+}
 
-            matrix[i][j] = l2(nodes[i], nodes[j]);
+// Every distance is computed once, for j < i
+adj_matrix_t matrixof(const std::vector<node_t> &nodes) {
+    adj_matrix_t matrix(nodes.size(), max_distance_bound(nodes),
+                        triangular_matrix(nodes.size()));
+
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        for (unsigned int j = 0; j < i; j++) {
+            matrix.set(i, j, l2(nodes[i], nodes[j]));
         }
     }
 
@@ -38,9 +72,9 @@ std::vector<node_t> read(std::ifstream &in) {
         node_t node;
 
         std::getline(ss, value, ';');
-        node.x = std::stoi(value);
+        node.x = std::stod(value);
         std::getline(ss, value, ';');
-        node.y = std::stoi(value);
+        node.y = std::stod(value);
         std::getline(ss, value, ';');
         node.weight = std::stoi(value);
 
@@ -50,8 +84,141 @@ std::vector<node_t> read(std::ifstream &in) {
     return nodes;
 }
 
+#pragma region TSPLIB
+
+inline std::string trim(const std::string &s) {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+inline bool is_tsplib(const std::string &fname) {
+    return fname.size() >= 4 && fname.substr(fname.size() - 4) == ".tsp";
+}
+
+// Instance files picked up from a directory: CSV and TSPLIB ones, not the
+// side files of the latter
+inline bool is_instance_file(const std::string &fname) {
+    return is_tsplib(fname) ||
+           (fname.size() >= 4 && fname.substr(fname.size() - 4) == ".csv");
+}
+
+// "id value..." lines of a TSPLIB section up to the next keyword, ids from 1
+template <typename fn_t>
+std::string read_section(std::ifstream &in, const std::string &fname,
+                         unsigned int n, fn_t &&fn) {
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        if (!std::isdigit(static_cast<unsigned char>(line[0]))) {
+            return line; // Next keyword
+        }
+
+        std::stringstream ss(line);
+        unsigned int id;
+        if (!(ss >> id) || id < 1 || id > n || !fn(id - 1, ss)) {
+            throw std::runtime_error("bad TSPLIB line \"" + line +
+                                     "\" in " + fname);
+        }
+    }
+    return "EOF";
+}
+
+// Weights of a TSPLIB instance without a NODE_WEIGHT_SECTION, "id weight"
+// lines in a side file next to it (<name>.weights). Optional.
+void read_side_weights(const std::string &fname, std::vector<node_t> &nodes) {
+    std::ifstream in(fname.substr(0, fname.size() - 4) + ".weights");
+    if (!in.is_open()) {
+        return;
+    }
+    read_section(in, fname, nodes.size(), [&](unsigned i, std::istream &ss) {
+        return bool(ss >> nodes[i].weight);
+    });
+}
+
+// EUC_2D instance in the TSPLIB format. Node weights come from a
+// NODE_WEIGHT_SECTION of "id weight" lines (our extension), else from the
+// side file, else they are 0. Distances are rounded like TSPLIB's nint.
+std::vector<node_t> read_tsplib(std::ifstream &in, const std::string &fname) {
+    std::vector<node_t> nodes;
+    std::vector<bool> placed; // Nodes given coordinates
+    bool weighted = false;
+    std::string line;
+    bool more = bool(std::getline(in, line));
+    while (more) {
+        size_t colon = line.find(':');
+        std::string key = trim(line.substr(0, colon));
+        std::string value =
+            colon == std::string::npos ? "" : trim(line.substr(colon + 1));
+
+        if (key == "EOF") {
+            break;
+        } else if (key == "DIMENSION") {
+            nodes.assign(std::stoul(value), node_t{0, 0, 0});
+            placed.assign(nodes.size(), false);
+        } else if (key == "EDGE_WEIGHT_TYPE" && value != "EUC_2D") {
+            throw std::runtime_error("unsupported EDGE_WEIGHT_TYPE " + value +
+                                     " in " + fname);
+        } else if (key == "NODE_COORD_SECTION") {
+            line = read_section(in, fname, nodes.size(),
+                                [&](unsigned int i, std::istream &ss) {
+                                    placed[i] = true;
+                                    return bool(ss >> nodes[i].x >>
+                                                nodes[i].y);
+                                });
+            continue;
+        } else if (key == "NODE_WEIGHT_SECTION") {
+            weighted = true;
+            line = read_section(in, fname, nodes.size(),
+                                [&](unsigned int i, std::istream &ss) {
+                                    return bool(ss >> nodes[i].weight);
+                                });
+            continue;
+        }
+
+        more = bool(std::getline(in, line));
+    }
+
+    if (nodes.empty()) {
+        throw std::runtime_error("no DIMENSION in " + fname);
+    }
+    unsigned int missing = std::count(placed.begin(), placed.end(), false);
+    if (missing > 0) {
+        throw std::runtime_error(std::to_string(missing) +
+                                 " node(s) without coordinates in " + fname);
+    }
+    if (!weighted) {
+        read_side_weights(fname, nodes);
+    }
+    return nodes;
+}
+
+#pragma endregion TSPLIB
+
+// Instance name of a data file, its name without directory and extension
+std::string instance_of(const std::string &fname) {
+    std::string name = fname.substr(fname.find_last_of("/\\") + 1);
+    return name.substr(0, name.find_last_of("."));
+}
+
 tsp_t parse(std::ifstream &in) {
     std::vector<node_t> nodes = read(in);
     adj_matrix_t matrix = matrixof(nodes);
     return tsp_t(nodes, matrix);
 }
+
+// Instance file in the format told by its extension: TSPLIB for .tsp,
+// otherwise x;y;weight lines
+tsp_t parse(std::ifstream &in, const std::string &fname) {
+    if (!is_tsplib(fname)) {
+        return parse(in);
+    }
+    std::vector<node_t> nodes = read_tsplib(in, fname);
+    adj_matrix_t matrix = matrixof(nodes);
+    return tsp_t(nodes, matrix);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own
+// jobs from the back (newest first, warm caches) and, when empty, steals
+// the oldest job from the front of another worker's deque. Jobs may
+// submit further jobs, which land on the submitting worker's deque.
+struct work_pool_t {
+    typedef std::function<void()> job_t;
+
+    struct queue_t {
+        std::mutex mutex;
+        std::deque<job_t> jobs;
+    };
+
+    std::vector<std::unique_ptr<queue_t>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> next_queue;
+
+    // Jobs submitted but not finished, guarded by `mutex`
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    size_t pending;
+    size_t queued;
+    bool stopping;
+
+    work_pool_t(unsigned int workers)
+        : queues(), threads(), next_queue(0), pending(0), queued(0),
+          stopping(false) {
+        workers = std::max(1u, workers);
+        for (unsigned int i = 0; i < workers; i++) {
+            queues.push_back(std::make_unique<queue_t>());
+        }
+        for (unsigned int i = 0; i < workers; i++) {
+            threads.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~work_pool_t() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    void submit(job_t job) {
+        unsigned int idx = worker_index();
+        if (idx >= queues.size()) {
+            idx = next_queue.fetch_add(1) % queues.size();
+        }
+
+        {
+            std::lock_guard lock(queues[idx]->mutex);
+            queues[idx]->jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard lock(mutex);
+            pending++;
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Block until every submitted job (and the jobs they submitted) is done
+    void wait() {
+        std::unique_lock lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+    }
+
+  private:
+    // Index of the calling worker, past the end for outside threads
+    static unsigned int &worker_index() {
+        thread_local unsigned int idx = UINT_MAX;
+        return idx;
+    }
+
+    std::optional<job_t> take(unsigned int self) {
+        for (unsigned int k = 0; k < queues.size(); k++) {
+            queue_t &queue = *queues[(self + k) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+
+            job_t job;
+            if (k == 0) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            } else {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+            return job;
+        }
+        return {};
+    }
+
+    void work(unsigned int self) {
+        worker_index() = self;
+
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this] { return queued > 0 || stopping; });
+                if (queued == 0 && stopping) {
+                    return;
+                }
+                queued--;
+            }
+
+            // A job is reserved for this worker, find it
+            std::optional<job_t> job;
+            while (!(job = take(self)).has_value()) {
+                std::this_thread::yield();
+            }
+            (*job)();
+
+            bool idle;
+            {
+                std::lock_guard lock(mutex);
+                idle = --pending == 0;
+            }
+            if (idle) {
+                done.notify_all();
+            }
+        }
+    }
+};
@@ -2,33 +2,39 @@
 
 #include "types.cpp"
 
+#include <climits>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <ostream>
 #include <vector>
 
-std::ostream &operator<<(std::ostream &os, const adj_list_t list) {
+std::ostream &operator<<(std::ostream &os, const adj_list_t &list) {
     for (const int &x : list) {
         os << x << ", ";
     }
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const adj_matrix_t matrix) {
-    int i = 0;
-    for (const adj_list_t &row : matrix) {
-        os << i++ << ": " << std::endl << "\t" << row << std::endl << std::endl;
+std::ostream &operator<<(std::ostream &os, const adj_matrix_t &matrix) {
+    unsigned int n = matrix.size();
+    adj_list_t row(n);
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            row[j] = matrix(i, j);
+        }
+        os << i << ": " << std::endl << "\t" << row << std::endl << std::endl;
     }
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const node_t node) {
+std::ostream &operator<<(std::ostream &os, const node_t &node) {
     os << "\t(" << node.x << ", " << node.y << ") weight: " << node.weight;
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const std::vector<node_t> nodes) {
+std::ostream &operator<<(std::ostream &os, const std::vector<node_t> &nodes) {
     int i = 0;
     for (const node_t &node : nodes) {
         os << i++ << node << std::endl;
@@ -36,15 +42,33 @@ std::ostream &operator<<(std::ostream &os, const std::vector<node_t> nodes) {
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const tsp_t tsp) {
+std::ostream &operator<<(std::ostream &os, const tsp_t &tsp) {
     os << "Nodes: " << std::endl << tsp.nodes << std::endl;
     os << "Adjacency matrix: " << std::endl << tsp.adj_matrix << std::endl;
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os, solution_t solution) {
+// Share of every phase in the total, e.g. "local_search 92.1%, ..."
+std::ostream &operator<<(std::ostream &os, const phase_times_t &phases) {
+    int64_t total = 0;
+    for (int64_t ns : phases) {
+        total += ns;
+    }
+
+    for (unsigned int i = 0; i < PHASE_COUNT; i++) {
+        if (i > 0) {
+            os << ", ";
+        }
+        os << phase_t_str[phase_t(i)] << " "
+           << (total > 0 ? 100.0 * phases[i] / total : 0.0) << "%";
+    }
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const solution_t &solution) {
     os << "Cost: " << solution.cost << "\tRuntime (ms): " << solution.runtime_ms
        << "\tSearch iterations: " << solution.search_iters << std::endl;
+    os << "Phases: " << solution.phase_ns << std::endl;
     os << "Path: ";
 
     for (const unsigned int &node : solution.path) {
@@ -56,76 +80,28 @@ std::ostream &operator<<(std::ostream &os, solution_t solution) {
     return os;
 }
 
-std::ostream &operator<<(std::ostream &os,
-                         const std::vector<solution_t> solutions) {
-    os << "Found " << solutions.size() << " solutions" << std::endl;
-
-    if (solutions.empty()) {
-        return os;
-    }
-
-    os << std::endl << "Solutions:" << std::endl;
-
-    int i = 0;
-    for (const solution_t &solution : solutions) {
-        os << "Solution " << i++ << ":" << std::endl << solution << std::endl;
-    }
-
-    os << std::endl;
-
-    std::optional<solution_t> best;
-    int min_cost = INT_MAX, min_time = INT_MAX, max_cost = 0, max_time = 0;
-    double avg_cost = 0, avg_time = 0;
-
-    for (const solution_t &solution : solutions) {
-        avg_cost += solution.cost;
-        avg_time += solution.runtime_ms;
-        if (solution.cost < min_cost) {
-            min_cost = solution.cost;
-            best = solution;
-        }
-        if (solution.cost > max_cost) {
-            max_cost = solution.cost;
-        }
-        if (solution.runtime_ms < min_time) {
-            min_time = solution.runtime_ms;
-        }
-        if (solution.runtime_ms > max_time) {
-            max_time = solution.runtime_ms;
-        }
-    }
-
-    os << "Stats:" << std::endl;
-    os << "Cost: " << min_cost << " / " << avg_cost / solutions.size() << " / "
-       << max_cost << std::endl;
-    os << "Runtime (ms): " << min_time << " / " << avg_time / solutions.size()
-       << " / " << max_time << std::endl;
-    os << std::endl;
-
-    if (best.has_value()) {
-        os << "Best solution:" << std::endl << best.value() << std::endl;
+// Header of the results CSV, see: write_csv_row
+void write_csv_header(std::ostream &os) {
+    os << "idx,cost,runtime_ms,search_iters,";
+    for (unsigned int p = 0; p < PHASE_COUNT; p++) {
+        os << phase_t_str[phase_t(p)] << "_ns,";
     }
-
-    return os;
+    os << "path" << std::endl;
 }
 
-std::ofstream &operator<<(std::ofstream &os,
-                          const std::vector<solution_t> solutions) {
-    os << "idx,cost,runtime_ms,search_iters,path" << std::endl;
-    int i = 0;
-
-    for (const solution_t &solution : solutions) {
-        os << i++ << "," << solution.cost << "," << solution.runtime_ms << ","
-           << solution.search_iters << ",";
-
-        for (const unsigned int &node : solution.path) {
-            os << node << " ";
-        }
+void write_csv_row(std::ostream &os, unsigned int idx,
+                   const solution_t &solution) {
+    os << idx << "," << solution.cost << "," << solution.runtime_ms << ","
+       << solution.search_iters << ",";
+    for (int64_t ns : solution.phase_ns) {
+        os << ns << ",";
+    }
 
-        os << std::endl;
+    for (const unsigned int &node : solution.path) {
+        os << node << " ";
     }
 
-    return os;
+    os << "\n";
 }
 
 std::ofstream &operator<<(std::ofstream &os, const operation_t &op) {
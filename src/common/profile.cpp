@@ -0,0 +1,84 @@
+#pragma once
+
+#include "trace.cpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Phases of the solvers that the profiler tells apart. Time spent in a run
+// outside of any scoped phase is charged to BOOKKEEPING.
+enum phase_t {
+    CONSTRUCT,
+    LOCAL_SEARCH,
+    PERTURB,
+    DESTROY,
+    REPAIR,
+    RECOMBINE,
+    BOOKKEEPING,
+    PHASE_COUNT
+};
+
+std::map<phase_t, std::string> phase_t_str = {
+    {CONSTRUCT, "construct"}, {LOCAL_SEARCH, "local_search"},
+    {PERTURB, "perturb"},     {DESTROY, "destroy"},
+    {REPAIR, "repair"},       {RECOMBINE, "recombine"},
+    {BOOKKEEPING, "bookkeeping"}};
+
+typedef std::array<int64_t, PHASE_COUNT> phase_times_t; // ns per phase
+
+// Per-thread accumulator. Elapsed time is charged to the current phase at
+// every phase switch, so nested phases are exclusive: the innermost scope
+// gets the time.
+struct profiler_t {
+    phase_times_t times = {};
+    phase_t current = BOOKKEEPING;
+    int64_t since = now_ns();
+
+    phase_t enter(phase_t phase) {
+        int64_t now = now_ns();
+        times[current] += now - since;
+        since = now;
+
+        phase_t prev = current;
+        current = phase;
+        return prev;
+    }
+};
+
+inline profiler_t &profiler() {
+    thread_local profiler_t instance;
+    return instance;
+}
+
+// Running totals of the calling thread. Runs take the difference of two
+// snapshots, so they may nest (e.g. MSLS inside a calibration run).
+inline phase_times_t profile_snapshot() {
+    profiler_t &p = profiler();
+    p.enter(p.current);
+    return p.times;
+}
+
+// Charges the lifetime of the scope to `phase`, and traces it when
+// tracing is enabled
+struct scoped_phase_t {
+    phase_t phase;
+    phase_t prev;
+
+    scoped_phase_t(phase_t phase)
+        : phase(phase), prev(profiler().enter(phase)) {
+        if (tracing_enabled.load(std::memory_order_relaxed)) {
+            trace_event(phase_t_str.at(phase).c_str(), 'B');
+        }
+    }
+    ~scoped_phase_t() {
+        profiler().enter(prev);
+        if (tracing_enabled.load(std::memory_order_relaxed)) {
+            trace_event(phase_t_str.at(phase).c_str(), 'E');
+        }
+    }
+
+    scoped_phase_t(const scoped_phase_t &) = delete;
+    scoped_phase_t &operator=(const scoped_phase_t &) = delete;
+};
@@ -1,18 +1,106 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <random>
-#include <vector>
 
-int random_num(int start, int end) {
-    std::random_device rd;  // obtain a random number from hardware
-    std::mt19937 gen(rd()); // seed the generator
-    std::uniform_int_distribution<> d(start, end - 1); // define the range
-    return d(gen);
+// SplitMix64 step, used to expand seeds into generator states
+inline uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
 }
 
-int random_num(const std::vector<int> &weights) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::discrete_distribution<> d(weights.cbegin(), weights.cend());
-    return d(gen);
+// xoshiro256++ generator, usable with the <random> distributions
+struct rng_t {
+    using result_type = uint64_t;
+    uint64_t s[4];
+
+    rng_t(uint64_t seed = 0) { reseed(seed); }
+
+    void reseed(uint64_t seed) {
+        for (uint64_t &word : s) {
+            word = splitmix64(seed);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+    }
+
+  private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// Base seed of the run; every stream is derived from it (see: --seed)
+std::atomic<uint64_t> rng_base_seed{std::random_device()()};
+std::atomic<uint64_t> rng_thread_count{0};
+
+inline uint64_t rng_stream_seed(uint64_t stream,
+                                uint64_t base = rng_base_seed.load()) {
+    uint64_t x = base ^ (stream * 0xd1b54a32d192ed03);
+    return splitmix64(x);
 }
+
+// Generator of the calling thread. Threads start on distinct streams;
+// call rng_stream to make a unit of work reproducible regardless of the
+// thread it runs on.
+inline rng_t &rng() {
+    thread_local rng_t engine(
+        rng_stream_seed(UINT32_MAX + rng_thread_count.fetch_add(1)));
+    return engine;
+}
+
+// Restart the calling thread's generator on the given stream, of the base
+// seed or of another one
+inline void rng_stream(uint64_t stream, uint64_t base = rng_base_seed.load()) {
+    rng().reseed(rng_stream_seed(stream, base));
+}
+
+// Set the base seed and restart the calling thread's generator
+inline void seed_rng(uint64_t seed) {
+    rng_base_seed = seed;
+    rng().reseed(rng_stream_seed(0));
+}
+
+// Uniform integer from [0, range), Lemire's multiply-shift rejection method
+inline uint32_t random_below(rng_t &engine, uint32_t range) {
+    uint64_t m = (engine() >> 32) * range;
+    uint32_t low = uint32_t(m);
+
+    if (low < range) {
+        uint32_t threshold = -range % range;
+        while (low < threshold) {
+            m = (engine() >> 32) * range;
+            low = uint32_t(m);
+        }
+    }
+
+    return m >> 32;
+}
+
+// Same, drawn from the calling thread's generator
+inline uint32_t random_below(uint32_t range) {
+    return random_below(rng(), range);
+}
+
+int random_num(int start, int end) { return start + random_below(end - start); }
+
+// Uniform real number from [0, 1)
+double random_real() { return (rng()() >> 11) * 0x1.0p-53; }
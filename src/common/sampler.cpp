@@ -0,0 +1,77 @@
+#pragma once
+
+#include "random.cpp"
+
+#include <algorithm>
+#include <vector>
+
+// Weighted sampling over a Fenwick tree: O(log n) sample, update and remove,
+// O(n) build. Drawing without replacement is sample + remove.
+struct weighted_sampler_t {
+    unsigned int n;
+    unsigned int top;         // Highest power of two not above n
+    std::vector<double> tree; // 1-indexed partial sums
+    std::vector<double> weights;
+
+    weighted_sampler_t(unsigned int n, double weight = 1.0)
+        : weighted_sampler_t(std::vector<double>(n, weight)) {}
+
+    weighted_sampler_t(const std::vector<double> &weights)
+        : n(weights.size()), top(1), tree(weights.size() + 1, 0),
+          weights(weights) {
+        while (top * 2 <= n) {
+            top *= 2;
+        }
+
+        for (unsigned int i = 1; i <= n; i++) {
+            tree[i] += weights[i - 1];
+            unsigned int parent = i + (i & -i);
+            if (parent <= n) {
+                tree[parent] += tree[i];
+            }
+        }
+    }
+
+    double total() const {
+        double sum = 0;
+        for (unsigned int i = n; i > 0; i -= i & -i) {
+            sum += tree[i];
+        }
+        return sum;
+    }
+
+    void update(unsigned int idx, double weight) {
+        double diff = weight - weights[idx];
+        weights[idx] = weight;
+        for (unsigned int i = idx + 1; i <= n; i += i & -i) {
+            tree[i] += diff;
+        }
+    }
+
+    void remove(unsigned int idx) { update(idx, 0); }
+
+    // Index drawn with probability proportional to its weight
+    unsigned int sample() const {
+        double target = random_real() * total();
+        unsigned int idx = 0;
+
+        for (unsigned int step = top; step > 0; step /= 2) {
+            if (idx + step <= n && tree[idx + step] <= target) {
+                idx += step;
+                target -= tree[idx];
+            }
+        }
+
+        // Rounding may land past the end or on an emptied slot, move to the
+        // nearest live one
+        idx = std::min(idx, n - 1);
+        while (idx + 1 < n && weights[idx] <= 0) {
+            idx++;
+        }
+        while (idx > 0 && weights[idx] <= 0) {
+            idx--;
+        }
+
+        return idx;
+    }
+};
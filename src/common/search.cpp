@@ -3,12 +3,11 @@
 #include "types.cpp"
 
 #include <climits>
-#include <functional>
 #include <optional>
 #include <vector>
 
-node_delta_t find_nn(const solution_t &solution,
-                     std::function<int(unsigned int)> cost_func) {
+template <typename cost_fn_t>
+node_delta_t find_nn(const solution_t &solution, cost_fn_t cost_func) {
     std::optional<unsigned int> min;
     int min_cost = INT_MAX;
 
@@ -54,9 +53,8 @@ std::vector<unsigned int> find_cycle(const tsp_t &tsp, unsigned int start) {
                 continue;
             }
 
-            int cost = tsp.weights[i] + tsp.weights[j] + tsp.weights[start] +
-                       tsp.adj_matrix(start, i) + tsp.adj_matrix(i, j) +
-                       tsp.adj_matrix(j, start);
+            int cost = tsp.arrival_cost(start, i) + tsp.arrival_cost(i, j) +
+                       tsp.arrival_cost(j, start);
 
             if (cost < min_cost || !path.has_value()) {
                 min_cost = cost;
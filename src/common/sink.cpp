@@ -0,0 +1,267 @@
+#pragma once
+
+#include "print.cpp"
+#include "types.cpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+// Welford's streaming mean and variance, plus min and max
+struct running_stats_t {
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void push(double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+
+    double stddev() const {
+        return count > 1 ? std::sqrt(m2 / (count - 1)) : 0;
+    }
+};
+
+std::ostream &operator<<(std::ostream &os, const running_stats_t &stats) {
+    os << stats.min << " / " << stats.mean << " / " << stats.max
+       << " (sd " << stats.stddev() << ")";
+    return os;
+}
+
+// Destination of finished runs. Solvers push every solution as soon as it
+// is done; sinks only read it and never keep a copy. Not thread-safe, the
+// caller serializes pushes.
+struct result_sink_t {
+    virtual ~result_sink_t() = default;
+    virtual void push(unsigned int idx, const solution_t &solution) = 0;
+    virtual void finish() {}
+};
+
+// Cost and runtime statistics of the runs, nothing per run
+struct stats_sink_t : result_sink_t {
+    running_stats_t costs, runtimes;
+
+    void push(unsigned int, const solution_t &solution) override {
+        costs.push(solution.cost);
+        runtimes.push(solution.runtime_ms);
+    }
+};
+
+// Rows of the results CSV, flushed as they arrive
+struct csv_sink_t : result_sink_t {
+    std::ostream &os;
+
+    csv_sink_t(std::ostream &os) : os(os) { write_csv_header(os); }
+
+    void push(unsigned int idx, const solution_t &solution) override {
+        write_csv_row(os, idx, solution);
+        os.flush();
+    }
+};
+
+// Human-readable summary: every solution as it arrives (if verbose), then
+// the cost and runtime statistics, the phase breakdown and the best path
+struct summary_sink_t : result_sink_t {
+    std::ostream &os;
+    bool verbose;
+    running_stats_t costs, runtimes;
+    phase_times_t phases = {};
+    total_cost_t best_cost = INT64_MAX;
+    std::vector<unsigned int> best_path;
+
+    summary_sink_t(std::ostream &os, bool verbose = true)
+        : os(os), verbose(verbose) {}
+
+    void push(unsigned int idx, const solution_t &solution) override {
+        if (verbose) {
+            os << "Solution " << idx << ":" << std::endl
+               << solution << std::endl;
+        }
+
+        costs.push(solution.cost);
+        runtimes.push(solution.runtime_ms);
+        for (unsigned int i = 0; i < PHASE_COUNT; i++) {
+            phases[i] += solution.phase_ns[i];
+        }
+        if (solution.cost < best_cost) {
+            best_cost = solution.cost;
+            best_path = solution.path;
+        }
+    }
+
+    void finish() override {
+        os << "Found " << costs.count << " solutions" << std::endl;
+        if (costs.count == 0) {
+            return;
+        }
+
+        os << std::endl << "Stats:" << std::endl;
+        os << "Cost: " << costs << std::endl;
+        os << "Runtime (ms): " << runtimes << std::endl;
+        os << "Phases: " << phases << std::endl;
+        os << std::endl;
+
+        os << "Best solution:" << std::endl << "Cost: " << best_cost
+           << std::endl << "Path: ";
+        for (unsigned int node : best_path) {
+            os << node << ", ";
+        }
+        os << std::endl;
+    }
+};
+
+#define BINARY_RESULTS_MAGIC 0x52505354 // "TSPR"
+#define BINARY_RESULTS_VERSION 2
+
+static_assert(sizeof(unsigned int) == sizeof(uint32_t));
+
+template <typename value_t> void write_binary(std::ostream &os, value_t value) {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename value_t> bool read_binary(std::istream &is, value_t &value) {
+    return bool(is.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// Bytes ahead of the path length in write_solution_binary: cost,
+// runtime_ms, search_iters and phase_ns
+#define SOLUTION_BINARY_FIELDS                                                 \
+    (sizeof(int64_t) + sizeof(double) + sizeof(int32_t) +                      \
+     sizeof(phase_times_t))
+
+static_assert(sizeof(total_cost_t) == sizeof(int64_t));
+
+// cost, runtime_ms, search_iters, phase_ns, path length and path, in native
+// byte order
+void write_solution_binary(std::ostream &os, const solution_t &solution) {
+    write_binary<int64_t>(os, solution.cost);
+    write_binary<double>(os, solution.runtime_ms);
+    write_binary<int32_t>(os, solution.search_iters);
+    for (int64_t ns : solution.phase_ns) {
+        write_binary<int64_t>(os, ns);
+    }
+    write_binary<uint32_t>(os, solution.path.size());
+    os.write(reinterpret_cast<const char *>(solution.path.data()),
+             solution.path.size() * sizeof(uint32_t));
+}
+
+// Inverse of write_solution_binary. Fails on a truncated record or a path
+// that does not fit the instance; the cost is recomputed from the path.
+std::optional<solution_t> read_solution_binary(std::istream &is,
+                                               const tsp_t &tsp) {
+    int64_t cost;
+    int32_t search_iters;
+    double runtime_ms;
+    phase_times_t phase_ns;
+    uint32_t size;
+    if (!read_binary(is, cost) || !read_binary(is, runtime_ms) ||
+        !read_binary(is, search_iters)) {
+        return {};
+    }
+    for (int64_t &ns : phase_ns) {
+        if (!read_binary(is, ns)) {
+            return {};
+        }
+    }
+    if (!read_binary(is, size) || size == 0 || size > tsp.n) {
+        return {};
+    }
+
+    std::vector<unsigned int> path(size);
+    if (!is.read(reinterpret_cast<char *>(path.data()),
+                 size * sizeof(uint32_t))) {
+        return {};
+    }
+    for (unsigned int node : path) {
+        if (node >= tsp.n) {
+            return {};
+        }
+    }
+
+    solution_t solution(tsp, std::move(path), runtime_ms, search_iters);
+    solution.phase_ns = phase_ns;
+    return solution;
+}
+
+// Skip a solution written by write_solution_binary
+bool skip_solution_binary(std::istream &is) {
+    std::streamsize fields = SOLUTION_BINARY_FIELDS;
+    uint32_t size;
+    if (!is.ignore(fields) || is.gcount() != fields ||
+        !read_binary(is, size)) {
+        return false;
+    }
+
+    std::streamsize path = std::streamsize(size) * sizeof(uint32_t);
+    return is.ignore(path) && is.gcount() == path;
+}
+
+// Compact binary results: a header (magic, version, phase count), then one
+// record per solution: its idx followed by write_solution_binary
+struct binary_sink_t : result_sink_t {
+    std::ostream &os;
+
+    binary_sink_t(std::ostream &os) : os(os) {
+        write_binary<uint32_t>(os, BINARY_RESULTS_MAGIC);
+        write_binary<uint32_t>(os, BINARY_RESULTS_VERSION);
+        write_binary<uint32_t>(os, PHASE_COUNT);
+    }
+
+    void push(unsigned int idx, const solution_t &solution) override {
+        write_binary<uint32_t>(os, idx);
+        write_solution_binary(os, solution);
+        os.flush();
+    }
+};
+
+// Forwards every solution to several sinks
+struct multi_sink_t : result_sink_t {
+    std::vector<result_sink_t *> sinks;
+
+    multi_sink_t(std::vector<result_sink_t *> sinks) : sinks(sinks) {}
+
+    void push(unsigned int idx, const solution_t &solution) override {
+        for (result_sink_t *sink : sinks) {
+            sink->push(idx, solution);
+        }
+    }
+
+    void finish() override {
+        for (result_sink_t *sink : sinks) {
+            sink->finish();
+        }
+    }
+};
+
+std::ostream &operator<<(std::ostream &os,
+                         const std::vector<solution_t> &solutions) {
+    summary_sink_t sink(os);
+    for (unsigned int i = 0; i < solutions.size(); i++) {
+        sink.push(i, solutions[i]);
+    }
+    sink.finish();
+    return os;
+}
+
+std::ofstream &operator<<(std::ofstream &os,
+                          const std::vector<solution_t> &solutions) {
+    csv_sink_t sink(os);
+    for (unsigned int i = 0; i < solutions.size(); i++) {
+        sink.push(i, solutions[i]);
+    }
+    return os;
+}
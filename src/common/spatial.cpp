@@ -0,0 +1,111 @@
+#pragma once
+
+#include "types.cpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Uniform grid over the node coordinates. Nodes are bucketed into square
+// cells (CSR layout) so spatial queries only touch the cells around a point.
+struct grid_index_t {
+    double min_x, min_y;
+    double cell_size;
+    int cols, rows;
+    std::vector<unsigned int> cell_start; // offsets into cell_nodes
+    std::vector<unsigned int> cell_nodes;
+    std::vector<unsigned int> node_cell;
+
+    grid_index_t(const std::vector<node_t> &nodes, unsigned int per_cell = 2)
+        : min_x(0), min_y(0), cell_size(1), cols(1), rows(1), cell_start(),
+          cell_nodes(nodes.size()), node_cell(nodes.size()) {
+        if (!nodes.empty()) {
+            double max_x = nodes[0].x, max_y = nodes[0].y;
+            min_x = nodes[0].x;
+            min_y = nodes[0].y;
+
+            for (const node_t &node : nodes) {
+                min_x = std::min<double>(min_x, node.x);
+                min_y = std::min<double>(min_y, node.y);
+                max_x = std::max<double>(max_x, node.x);
+                max_y = std::max<double>(max_y, node.y);
+            }
+
+            // Aim for roughly `per_cell` nodes in every cell. Cells are at
+            // least the longer side over that many, so a degenerate
+            // (collinear, axis-aligned) extent still gets about n cells
+            // rather than one per unit of its length.
+            double width = max_x - min_x, height = max_y - min_y;
+            double target = std::max(1.0, double(nodes.size()) / per_cell);
+            cell_size = std::max(std::sqrt(width * height / target),
+                                 std::max(width, height) / target);
+            if (!(cell_size > 0)) {
+                cell_size = 1; // All nodes on one point
+            }
+            double most = nodes.size();
+            cols = int(std::min(width / cell_size, most)) + 1;
+            rows = int(std::min(height / cell_size, most)) + 1;
+        }
+
+        size_t cells = size_t(cols) * rows;
+        cell_start.assign(cells + 1, 0);
+        for (unsigned int i = 0; i < nodes.size(); i++) {
+            node_cell[i] = cell_of(nodes[i]);
+            cell_start[node_cell[i] + 1]++;
+        }
+        for (size_t c = 0; c < cells; c++) {
+            cell_start[c + 1] += cell_start[c];
+        }
+
+        std::vector<unsigned int> fill(cell_start.begin(),
+                                       cell_start.end() - 1);
+        for (unsigned int i = 0; i < nodes.size(); i++) {
+            cell_nodes[fill[node_cell[i]]++] = i;
+        }
+    }
+
+    int col_of(double x) const {
+        return int(std::clamp((x - min_x) / cell_size, 0.0, cols - 1.0));
+    }
+
+    int row_of(double y) const {
+        return int(std::clamp((y - min_y) / cell_size, 0.0, rows - 1.0));
+    }
+
+    unsigned int cell_of(const node_t &node) const {
+        return row_of(node.y) * cols + col_of(node.x);
+    }
+
+    // Call fn(node) for every node in the square ring of cells at Chebyshev
+    // distance `radius` from cell (col, row). Returns false once the ring
+    // lies entirely outside the grid.
+    template <typename fn_t>
+    bool for_each_in_ring(int col, int row, int radius, fn_t &&fn) const {
+        bool any = false;
+
+        for (int r = row - radius; r <= row + radius; r++) {
+            if (r < 0 || r >= rows) {
+                continue;
+            }
+
+            bool edge_row = r == row - radius || r == row + radius;
+            int step = edge_row || radius == 0 ? 1 : 2 * radius;
+
+            for (int c = col - radius; c <= col + radius; c += step) {
+                if (c < 0 || c >= cols) {
+                    continue;
+                }
+
+                any = true;
+                unsigned int cell = r * cols + c;
+                for (unsigned int i = cell_start[cell];
+                     i < cell_start[cell + 1]; i++) {
+                    fn(cell_nodes[i]);
+                }
+            }
+        }
+
+        return any;
+    }
+};
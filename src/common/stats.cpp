@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 == 1) {
+        return upper;
+    }
+
+    return (*std::max_element(values.begin(), values.begin() + mid) + upper) /
+           2;
+}
+
+struct mann_whitney_t {
+    double u; // U statistic of the first sample
+    double z;
+    double p; // One-sided p-value of "first sample tends to be greater"
+};
+
+// Mann-Whitney U test with the normal approximation, tie and continuity
+// corrections. Good enough for the sample sizes of our runs (20 to 200).
+mann_whitney_t mann_whitney(const std::vector<double> &a,
+                            const std::vector<double> &b) {
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if (n1 == 0 || n2 == 0) {
+        return {0, 0, 1};
+    }
+
+    std::vector<std::pair<double, bool>> all; // (value, is from a)
+    all.reserve(n);
+    for (double x : a) {
+        all.push_back({x, true});
+    }
+    for (double x : b) {
+        all.push_back({x, false});
+    }
+    std::sort(all.begin(), all.end());
+
+    // Average ranks over ties, collecting the tie correction term
+    double rank_sum = 0, ties = 0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) {
+            j++;
+        }
+
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++) {
+            if (all[k].second) {
+                rank_sum += rank;
+            }
+        }
+
+        double t = j - i;
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    double u = rank_sum - n1 * (n1 + 1) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double var = n1 * n2 / 12.0 * ((n + 1) - ties / (double(n) * (n - 1)));
+    if (var <= 0) {
+        return {u, 0, 1};
+    }
+
+    double z = (u - mean - 0.5) / std::sqrt(var);
+    return {u, z, 0.5 * std::erfc(z / std::sqrt(2.0))};
+}
+
+// Pearson correlation of a stream of pairs, updated one pair at a time
+// with Welford's co-moments
+struct running_correlation_t {
+    uint64_t count = 0;
+    double mean_x = 0, mean_y = 0;
+    double m2_x = 0, m2_y = 0, co_moment = 0;
+
+    void push(double x, double y) {
+        count++;
+        double dx = x - mean_x;
+        double dy = y - mean_y;
+        mean_x += dx / count;
+        mean_y += dy / count;
+        m2_x += dx * (x - mean_x);
+        m2_y += dy * (y - mean_y);
+        co_moment += dx * (y - mean_y);
+    }
+
+    // 0 while either variable is constant
+    double r() const {
+        return m2_x > 0 && m2_y > 0 ? co_moment / std::sqrt(m2_x * m2_y) : 0;
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.cpp"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+// Per-instance tables shared read-only by every start of the constructive
+// heuristics (and by every thread running them). Built once per instance.
+struct tables_t {
+    unsigned int n;
+    // Row i holds all other nodes j ordered by d(i, j) + w(j), flattened
+    std::vector<unsigned int> sorted;
+    // Best two companions of every start node for the initial triangle
+    std::vector<std::array<unsigned int, 2>> triangles;
+
+    tables_t(const tsp_t &tsp)
+        : n(tsp.n), sorted(), triangles(tsp.n, {0, 0}) {
+        if (n < 2) {
+            return;
+        }
+
+        sorted.resize(size_t(n) * (n - 1));
+        std::vector<unsigned int> order(n);
+        std::vector<int> score(n);
+
+        for (unsigned int i = 0; i < n; i++) {
+            std::iota(order.begin(), order.end(), 0);
+            for (unsigned int j = 0; j < n; j++) {
+                score[j] = tsp.arrival_cost(i, j);
+            }
+
+            std::stable_sort(order.begin(), order.end(),
+                             [&score](unsigned int a, unsigned int b) {
+                                 return score[a] < score[b];
+                             });
+            std::copy_if(order.begin(), order.end(),
+                         sorted.begin() + size_t(i) * (n - 1),
+                         [i](unsigned int j) { return j != i; });
+        }
+
+        for (unsigned int start = 0; start < n && n >= 3; start++) {
+            triangles[start] = best_triangle(tsp, start);
+        }
+    }
+
+    const unsigned int *neighbors(unsigned int node) const {
+        return sorted.data() + size_t(node) * (n - 1);
+    }
+
+    // Cheapest cycle through start and two other nodes (see: find_cycle)
+    std::vector<unsigned int> cycle(unsigned int start) const {
+        return {start, triangles[start][0], triangles[start][1]};
+    }
+
+  private:
+    // The triangle cost is w(s) + c(s, i) + c(s, j) + d(i, j) with
+    // c(s, x) = d(s, x) + w(x), so walking the sorted row of s gives the
+    // lower bound w(s) + c(s, i) + c(s, j) and prunes almost every pair.
+    std::array<unsigned int, 2> best_triangle(const tsp_t &tsp,
+                                              unsigned int start) const {
+        const unsigned int *row = neighbors(start);
+        auto c = [&](unsigned int x) { return tsp.arrival_cost(start, x); };
+
+        int min_cost = INT_MAX;
+        std::array<unsigned int, 2> best = {row[0], row[1]};
+
+        for (unsigned int a = 0; a + 1 < n - 1; a++) {
+            int ca = c(row[a]);
+            if (tsp.weights[start] + ca + c(row[a + 1]) >= min_cost) {
+                break;
+            }
+
+            for (unsigned int b = a + 1; b < n - 1; b++) {
+                int bound = tsp.weights[start] + ca + c(row[b]);
+                if (bound >= min_cost) {
+                    break;
+                }
+
+                int cost = bound + tsp.adj_matrix(row[a], row[b]);
+                if (cost < min_cost) {
+                    min_cost = cost;
+                    best = {row[a], row[b]};
+                }
+            }
+        }
+
+        return best;
+    }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#define TRACE_RESERVE (1 << 16) // Events reserved per thread on first use
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Set by --trace before any solving starts. When false every trace call is
+// a single branch.
+std::atomic<bool> tracing_enabled{false};
+
+struct trace_event_t {
+    const char *name; // Must outlive the trace (literals, *_str entries)
+    char phase;       // 'B'egin or 'E'nd
+    int64_t ts_ns;
+};
+
+// Events of one thread. Only the owning thread appends, the buffers are
+// read after the threads are done.
+struct trace_buffer_t {
+    unsigned int tid;
+    std::vector<trace_event_t> events;
+};
+
+struct trace_registry_t {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<trace_buffer_t>> buffers;
+    int64_t start_ns = now_ns();
+
+    trace_buffer_t *add_buffer() {
+        std::lock_guard lock(mutex);
+        buffers.push_back(std::make_unique<trace_buffer_t>());
+        buffers.back()->tid = buffers.size();
+        buffers.back()->events.reserve(TRACE_RESERVE);
+        return buffers.back().get();
+    }
+};
+
+inline trace_registry_t &trace_registry() {
+    static trace_registry_t registry;
+    return registry;
+}
+
+inline void trace_event(const char *name, char phase) {
+    if (!tracing_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    thread_local trace_buffer_t *buffer = trace_registry().add_buffer();
+    buffer->events.push_back({name, phase, now_ns()});
+}
+
+// Begin/end event pair around the lifetime of the scope
+struct scoped_trace_t {
+    const char *name;
+
+    scoped_trace_t(const char *name) : name(name) { trace_event(name, 'B'); }
+    ~scoped_trace_t() { trace_event(name, 'E'); }
+
+    scoped_trace_t(const scoped_trace_t &) = delete;
+    scoped_trace_t &operator=(const scoped_trace_t &) = delete;
+};
+
+// Chrome trace-event JSON, opens in Perfetto and chrome://tracing
+void write_trace(std::ostream &os) {
+    trace_registry_t &registry = trace_registry();
+    std::lock_guard lock(registry.mutex);
+
+    os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto &buffer : registry.buffers) {
+        os << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": "
+           << "\"M\", \"pid\": 1, \"tid\": " << buffer->tid
+           << ", \"args\": {\"name\": \"worker " << buffer->tid << "\"}}";
+        first = false;
+
+        for (const trace_event_t &event : buffer->events) {
+            os << ",\n{\"name\": \"" << event.name << "\", \"ph\": \""
+               << event.phase << "\", \"pid\": 1, \"tid\": " << buffer->tid
+               << ", \"ts\": " << (event.ts_ns - registry.start_ns) / 1000.0
+               << "}";
+        }
+    }
+    os << "\n]}" << std::endl;
+}
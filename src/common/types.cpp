@@ -1,7 +1,12 @@
 #pragma once
 
+#include "counters.cpp"
+#include "profile.cpp"
+
 #include <algorithm>
 #include <chrono>
+#include <climits>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
 #include <unordered_set>
@@ -9,8 +14,8 @@
 #include <vector>
 
 struct node_t {
-    int x;
-    int y;
+    double x;
+    double y;
     int weight;
 };
 
@@ -40,71 +45,200 @@ template <> struct std::hash<edge_t> {
 
 typedef std::vector<int> adj_list_t; // list of weights
 
+// Distances of a symmetric instance in one flat array, in the narrowest
+// cells that hold the longest distance (uint16_t for TSPA/TSPB) and either
+// the full n x n square or (triangular) only the lower triangle with the
+// diagonal, at about half the memory. The triangular index takes min/max
+// of the two nodes, which compile to conditional moves. Width and layout
+// are fixed per instance, so their branches in a lookup always predict.
 struct adj_matrix_t {
-    using matrix_t = std::vector<adj_list_t>;
-    matrix_t m;
+    unsigned int n;
+    bool triangular;
+    std::vector<uint16_t> narrow_cells; // Either these
+    std::vector<uint32_t> wide_cells;   // or these
+
+    adj_matrix_t(unsigned int n, int max_distance = INT_MAX,
+                 bool triangular = false)
+        : n(n), triangular(triangular), narrow_cells(), wide_cells() {
+        if (narrow(max_distance)) {
+            narrow_cells.resize(cells(n, triangular));
+        } else {
+            wide_cells.resize(cells(n, triangular));
+        }
+    }
+
+    static bool narrow(int max_distance) { return max_distance <= UINT16_MAX; }
 
-    adj_matrix_t(unsigned int n) : m(n, adj_list_t(n, 0)) {}
+    static size_t cells(unsigned int n, bool triangular) {
+        return triangular ? size_t(n) * (n + 1) / 2 : size_t(n) * n;
+    }
+
+    static size_t bytes(unsigned int n, int max_distance, bool triangular) {
+        return cells(n, triangular) * (narrow(max_distance) ? 2 : 4);
+    }
+
+    size_t index(unsigned int i, unsigned int j) const {
+        if (triangular) {
+            size_t lo = std::min(i, j), hi = std::max(i, j);
+            return hi * (hi + 1) / 2 + lo;
+        }
+        return size_t(i) * n + j;
+    }
 
-    int &operator()(unsigned int i, unsigned int j) { return m.at(i).at(j); }
     int operator()(unsigned int i, unsigned int j) const {
-        return m.at(i).at(j);
+        size_t k = index(i, j);
+        return wide_cells.empty() ? narrow_cells[k] : int(wide_cells[k]);
     }
 
-    adj_list_t &operator[](unsigned int i) { return m.at(i); }
-    adj_list_t operator[](unsigned int i) const { return m.at(i); }
+    void set(unsigned int i, unsigned int j, int distance) {
+        for (size_t k : {index(i, j), index(j, i)}) {
+            if (wide_cells.empty()) {
+                narrow_cells[k] = uint16_t(distance);
+            } else {
+                wide_cells[k] = uint32_t(distance);
+            }
+        }
+    }
 
-    matrix_t::iterator begin() { return m.begin(); }
-    matrix_t::iterator end() { return m.end(); }
-    matrix_t::const_iterator begin() const { return m.begin(); }
-    matrix_t::const_iterator end() const { return m.end(); }
+    unsigned int size() const { return n; }
 };
 
+#define ARRIVAL_MAX_BYTES (4 << 20) // Largest arrival matrix, 1024 nodes
+
+// Fused arrival costs c(i, j) = d(i, j) + w(j), the cost of moving on from
+// i to j, in a flat n x n int array (asymmetric, so always square). The
+// weighted deltas read one array instead of two with it (see: tsp_t). Only
+// built while it stays within ARRIVAL_MAX_BYTES: it is at least twice the
+// distance matrix, and past cache size the extra memory costs more than
+// the lookup saves.
+struct arrival_matrix_t {
+    unsigned int n = 0;
+    std::vector<int> cells;
+
+    arrival_matrix_t() = default;
+
+    static size_t bytes(unsigned int n) { return size_t(n) * n * sizeof(int); }
+
+    static bool fits(unsigned int n) { return bytes(n) <= ARRIVAL_MAX_BYTES; }
+
+    arrival_matrix_t(const adj_matrix_t &matrix,
+                     const std::vector<int> &weights)
+        : n(weights.size()), cells(size_t(n) * n) {
+        for (unsigned int i = 0; i < n; i++) {
+            for (unsigned int j = 0; j < n; j++) {
+                cells[size_t(i) * n + j] = matrix(i, j) + weights[j];
+            }
+        }
+    }
+
+    bool empty() const { return cells.empty(); }
+
+    int operator()(unsigned int i, unsigned int j) const {
+        return cells[size_t(i) * n + j];
+    }
+};
+
+// A -DTSP_CHECK_FUSED build checks every fused cost against the unfused one
+// (regress spot-checks them in any build, see: check_fused)
+#ifdef TSP_CHECK_FUSED
+#define CHECK_FUSED(fused, unfused)                                           \
+    do {                                                                      \
+        if ((fused) != (unfused)) {                                           \
+            throw std::logic_error("Fused cost disagrees: " #fused);          \
+        }                                                                     \
+    } while (0)
+#else
+#define CHECK_FUSED(fused, unfused) ((void)0)
+#endif
+
 struct tsp_t {
     unsigned int n;
     std::vector<node_t> nodes;
     std::vector<int> weights;
     adj_matrix_t adj_matrix;
+    arrival_matrix_t arrival; // Empty above ARRIVAL_MAX_BYTES
 
     tsp_t(std::vector<node_t> nodes, adj_matrix_t adj_matrix)
-        : n(nodes.size()), nodes(nodes), weights(nodes.size(), 0),
-          adj_matrix(adj_matrix) {
+        : n(nodes.size()), nodes(std::move(nodes)), weights(n, 0),
+          adj_matrix(std::move(adj_matrix)), arrival() {
         for (int i = 0; i < n; i++) {
-            weights[i] = nodes[i].weight;
+            weights[i] = this->nodes[i].weight;
+        }
+        if (arrival_matrix_t::fits(n)) {
+            arrival = arrival_matrix_t(this->adj_matrix, weights);
         }
     }
+
+    // c(i, j) = d(i, j) + w(j)
+    int arrival_cost(unsigned int i, unsigned int j) const {
+        if (arrival.empty()) {
+            return adj_matrix(i, j) + weights[j];
+        }
+        CHECK_FUSED(arrival(i, j), adj_matrix(i, j) + weights[j]);
+        return arrival(i, j);
+    }
+
+    // Cost delta of visiting node between a and b,
+    // c(a, node) + c(node, b) - c(a, b) as w(b) cancels out
+    int insertion_cost(unsigned int a, unsigned int node,
+                       unsigned int b) const {
+        if (arrival.empty()) {
+            return weights[node] + adj_matrix(a, node) + adj_matrix(node, b) -
+                   adj_matrix(a, b);
+        }
+        int fused = arrival(a, node) + arrival(node, b) - arrival(a, b);
+        CHECK_FUSED(fused, weights[node] + adj_matrix(a, node) +
+                               adj_matrix(node, b) - adj_matrix(a, b));
+        return fused;
+    }
+};
+
+// Cost model of the plain objective: edge lengths plus node weights. The
+// delta functions of solution_t are templated over such a model, so search
+// methods can evaluate moves under modified (e.g. penalized) costs.
+struct base_cost_t {
+    const tsp_t *tsp;
+
+    int edge(unsigned int a, unsigned int b) const {
+        return tsp->adj_matrix(a, b);
+    }
+    int node(unsigned int v) const { return tsp->weights[v]; }
 };
 
+// Tour totals are 64-bit, edge lengths, weights and move deltas stay int
+typedef int64_t total_cost_t;
+
 struct solution_t {
-    int cost;
-    int runtime_ms;
+    total_cost_t cost;
+    double runtime_ms;
     int search_iters;
+    phase_times_t phase_ns;
     std::vector<unsigned int> path;
     std::unordered_set<unsigned int> remaining_nodes;
     const tsp_t *tsp;
+    [[no_unique_address]] alloc_counter_t alloc_counter;
 
     solution_t(const tsp_t &tsp, std::vector<unsigned int> path,
-               int runtime_ms = 0, int search_iters = 0)
+               double runtime_ms = 0, int search_iters = 0)
         : cost(0), runtime_ms(runtime_ms), search_iters(search_iters),
-          path(path), remaining_nodes(), tsp(&tsp) {
+          phase_ns(), path(path), remaining_nodes(), tsp(&tsp) {
         for (unsigned int i = 0; i < tsp.n; i++) {
             remaining_nodes.insert(i);
         }
 
         for (unsigned int i = 0; i < path.size() - 1; i++) {
-            cost += tsp.adj_matrix(path[i], path[i + 1]) + tsp.weights[path[i]];
+            cost += tsp.arrival_cost(path[i], path[i + 1]);
             remaining_nodes.erase(path[i]);
         }
 
         remaining_nodes.erase(path.back());
 
-        cost += tsp.adj_matrix(path.back(), path.front()) +
-                tsp.weights[path.back()];
+        cost += tsp.arrival_cost(path.back(), path.front());
     }
 
     solution_t(const tsp_t &tsp, unsigned int start)
         : cost(tsp.weights[start]), runtime_ms(0), search_iters(0),
-          path({start}), remaining_nodes(), tsp(&tsp) {
+          phase_ns(), path({start}), remaining_nodes(), tsp(&tsp) {
         for (unsigned int i = 0; i < tsp.n; i++) {
             if (i == start) {
                 continue;
@@ -120,20 +254,23 @@ struct solution_t {
 
     // Append node to the end of the path ({0, 1, 2} -> {0, 1, 2, node})
     void append(unsigned int node) {
-        cost += tsp->adj_matrix(path.back(), node) + tsp->weights[node];
+        STAT(MOVE_APPEND);
+        cost += append_delta(node);
         path.push_back(node);
         remaining_nodes.erase(node);
     }
 
     // Prepend node to the beginning of the path ({0, 1, 2} -> {node, 0, 1, 2})
     void prepend(unsigned int node) {
-        cost += tsp->adj_matrix(node, path.front()) + tsp->weights[node];
+        STAT(MOVE_PREPEND);
+        cost += prepend_delta(node);
         path.insert(path.begin(), node);
         remaining_nodes.erase(node);
     }
 
     // Insert node after the node at pos ({0, 1, 2} -> 1 -> {0, 1, node, 2})
     void insert(unsigned int node, int pos) {
+        STAT(MOVE_INSERT);
         cost += insert_delta(node, pos);
         path.insert(path.begin() + pos + 1, node);
         remaining_nodes.erase(node);
@@ -141,13 +278,58 @@ struct solution_t {
 
     // Delete node at pos ({0, 1, 2} -> 1 -> {0, 2})
     void remove(int pos) {
+        STAT(MOVE_REMOVE);
         cost += remove_delta(pos);
         remaining_nodes.insert(path[pos]);
         path.erase(path.begin() + pos);
     }
 
+    // Delete nodes at all the given (distinct) positions in a single pass
+    // ({0, 1, 2, 3} -> {1, 2} -> {0, 3}). The cost is updated per removed
+    // run of consecutive positions, in O(k) lookups; compacting the path
+    // itself stays a linear move.
+    void remove(const std::vector<unsigned int> &positions) {
+        STAT_ADD(MOVE_REMOVE, positions.size());
+        std::vector<bool> removed(path.size(), false);
+        for (unsigned int pos : positions) {
+            removed[pos] = true;
+        }
+
+        if (positions.size() >= path.size()) {
+            cost = 0;
+        } else {
+            for (unsigned int pos : positions) {
+                cost -= tsp->weights[path[pos]] +
+                        tsp->adj_matrix(path[pos], path[next(pos)]);
+                if (removed[prev(pos)]) {
+                    continue;
+                }
+                // First of a run: bridge its kept neighbours
+                unsigned int end = pos;
+                while (removed[next(end)]) {
+                    end = next(end);
+                }
+                unsigned int before = path[prev(pos)];
+                cost += tsp->adj_matrix(before, path[next(end)]) -
+                        tsp->adj_matrix(before, path[pos]);
+            }
+        }
+
+        unsigned int size = 0;
+        for (unsigned int i = 0; i < path.size(); i++) {
+            if (removed[i]) {
+                remaining_nodes.insert(path[i]);
+            } else {
+                path[size++] = path[i];
+            }
+        }
+
+        path.resize(size);
+    }
+
     // Replace node at pos with node ({0, 1, 2} -> 1 -> {0, node, 2})
     void replace(unsigned int node, int pos) {
+        STAT(MOVE_REPLACE);
         cost += replace_delta(node, pos);
         remaining_nodes.erase(node);
         remaining_nodes.insert(path[pos]);
@@ -156,6 +338,7 @@ struct solution_t {
 
     // Swap nodes at pos1 and pos2 ({0, 1, 2} -> 1, 2 -> {0, 2, 1})
     void swap(int pos1, int pos2) {
+        STAT(MOVE_SWAP);
         cost += swap_delta(pos1, pos2);
         std::swap(path[pos1], path[pos2]);
     }
@@ -168,6 +351,7 @@ struct solution_t {
                 "Trying to reverse from higher to lower pos");
         }
 
+        STAT(MOVE_REVERSE);
         cost += reverse_delta(pos1, pos2);
         std::reverse(path.begin() + pos1, path.begin() + pos2 + 1);
     }
@@ -175,45 +359,101 @@ struct solution_t {
 #pragma endregion Operators
 
 #pragma region Cost functions
+    // The plain deltas below read the fused arrival costs c(i, j) of the
+    // instance when it has them (see: arrival_matrix_t); the node weights
+    // then cancel out or come with the edges. Deltas under another cost
+    // model take the templated overloads. The positions are read before
+    // branching, so that loops over the nodes of one pos can hoist them
+    // (and the modulo of prev/next) on either path.
+
     // Cost delta of appending node to the path (see: append)
     int append_delta(unsigned int node) const {
-        return tsp->adj_matrix(path.back(), node) + tsp->weights[node];
+        return tsp->arrival_cost(path.back(), node);
     }
 
     // Cost delta of prepending node to the path (see: prepend)
     int prepend_delta(unsigned int node) const {
-        return tsp->adj_matrix(node, path.front()) + tsp->weights[node];
+        return tsp->arrival_cost(path.front(), node);
     }
 
     // Cost delta of inserting node at pos (see: insert)
     int insert_delta(unsigned int node, int pos) const {
+        STAT(DELTA_INSERT);
+        return tsp->insertion_cost(path[pos], node, path[next(pos)]);
+    }
+
+    template <typename cost_t>
+    int insert_delta(unsigned int node, int pos, const cost_t &cost) const {
+        STAT(DELTA_INSERT);
         unsigned int a = path[pos];
         unsigned int b = path[next(pos)];
-        return tsp->weights[node] + tsp->adj_matrix(a, node) +
-               tsp->adj_matrix(node, b) - tsp->adj_matrix(a, b);
+        return cost.node(node) + cost.edge(a, node) + cost.edge(node, b) -
+               cost.edge(a, b);
+    }
+
+    // Cost delta of deleting node at pos (see: remove)
+    int remove_delta(int pos) const {
+        unsigned a = path[prev(pos)];
+        unsigned b = path[pos];
+        unsigned d = path[next(pos)];
+        const arrival_matrix_t &c = tsp->arrival;
+        if (c.empty()) {
+            return remove_delta(pos, base_cost_t{tsp});
+        }
+        STAT(DELTA_REMOVE);
+        int fused = c(a, d) - c(a, b) - c(b, d);
+        CHECK_FUSED(fused, remove_delta(pos, base_cost_t{tsp}));
+        return fused;
     }
 
-    int remove_delta(int pos) {
+    template <typename cost_t>
+    int remove_delta(int pos, const cost_t &cost) const {
+        STAT(DELTA_REMOVE);
         unsigned a = path[prev(pos)];
         unsigned b = path[pos];
         unsigned c = path[next(pos)];
-        return tsp->adj_matrix(a, c) - tsp->adj_matrix(a, b) -
-               tsp->adj_matrix(b, c) - tsp->weights[b];
+        return cost.edge(a, c) - cost.edge(a, b) - cost.edge(b, c) -
+               cost.node(b);
+    }
+
+    // Cost delta of replacing node at pos (see: replace). Forced inline: with
+    // both paths it is too big for the inliner, and the search loops would
+    // lose their hoisted lookups to a call per node.
+    [[gnu::always_inline]] int replace_delta(unsigned int node,
+                                             int pos) const {
+        unsigned int old_node = path[pos];
+        unsigned int a = path[prev(pos)];
+        unsigned int b = path[next(pos)];
+        const arrival_matrix_t &c = tsp->arrival;
+        if (c.empty()) {
+            return replace_delta(node, pos, base_cost_t{tsp});
+        }
+        STAT(DELTA_REPLACE);
+        int fused = c(a, node) + c(node, b) - c(a, old_node) - c(old_node, b);
+        CHECK_FUSED(fused, replace_delta(node, pos, base_cost_t{tsp}));
+        return fused;
     }
 
-    // Cost delta of replacing node at pos (see: replace)
-    int replace_delta(unsigned int node, int pos) const {
+    template <typename cost_t>
+    int replace_delta(unsigned int node, int pos, const cost_t &cost) const {
+        STAT(DELTA_REPLACE);
         unsigned int old_node = path[pos];
         unsigned int a = path[prev(pos)];
         unsigned int b = path[next(pos)];
 
-        return tsp->adj_matrix(a, node) + tsp->adj_matrix(node, b) +
-               tsp->weights[node] - tsp->adj_matrix(a, old_node) -
-               tsp->adj_matrix(old_node, b) - tsp->weights[old_node];
+        return cost.edge(a, node) + cost.edge(node, b) + cost.node(node) -
+               cost.edge(a, old_node) - cost.edge(old_node, b) -
+               cost.node(old_node);
     }
 
     // Cost delta of swapping nodes at pos1 and pos2 (see: swap)
     int swap_delta(int pos1, int pos2) const {
+        return swap_delta(pos1, pos2, base_cost_t{tsp});
+    }
+
+    template <typename cost_t>
+    int swap_delta(int pos1, int pos2, const cost_t &cost) const {
+        STAT(DELTA_SWAP);
         unsigned node1 = path[pos1];
         unsigned node2 = path[pos2];
 
@@ -224,24 +464,30 @@ struct solution_t {
 
         // next to each other
         if (node2 == b1) {
-            return tsp->adj_matrix(a1, node2) + tsp->adj_matrix(node1, b2) -
-                   tsp->adj_matrix(a1, node1) - tsp->adj_matrix(node2, b2);
+            return cost.edge(a1, node2) + cost.edge(node1, b2) -
+                   cost.edge(a1, node1) - cost.edge(node2, b2);
         }
 
         // loop
         if (node1 == b2) {
-            return tsp->adj_matrix(a2, node1) + tsp->adj_matrix(node2, b1) -
-                   tsp->adj_matrix(a2, node2) - tsp->adj_matrix(node1, b1);
+            return cost.edge(a2, node1) + cost.edge(node2, b1) -
+                   cost.edge(a2, node2) - cost.edge(node1, b1);
         }
 
-        return tsp->adj_matrix(a1, node2) + tsp->adj_matrix(node2, b1) +
-               tsp->adj_matrix(a2, node1) + tsp->adj_matrix(node1, b2) -
-               tsp->adj_matrix(a1, node1) - tsp->adj_matrix(node1, b1) -
-               tsp->adj_matrix(a2, node2) - tsp->adj_matrix(node2, b2);
+        return cost.edge(a1, node2) + cost.edge(node2, b1) +
+               cost.edge(a2, node1) + cost.edge(node1, b2) -
+               cost.edge(a1, node1) - cost.edge(node1, b1) -
+               cost.edge(a2, node2) - cost.edge(node2, b2);
     }
 
     // Cost delta of reversing the path from pos1 to pos2 (see: reverse)
     int reverse_delta(int pos1, int pos2) const {
+        return reverse_delta(pos1, pos2, base_cost_t{tsp});
+    }
+
+    template <typename cost_t>
+    int reverse_delta(int pos1, int pos2, const cost_t &cost) const {
+        STAT(DELTA_REVERSE);
         int a = path[prev(pos1)];
         int b = path[pos1];
         int c = path[pos2];
@@ -251,8 +497,8 @@ struct solution_t {
             return 0;
         }
 
-        return tsp->adj_matrix(a, c) + tsp->adj_matrix(b, d) -
-               tsp->adj_matrix(a, b) - tsp->adj_matrix(c, d);
+        return cost.edge(a, c) + cost.edge(b, d) - cost.edge(a, b) -
+               cost.edge(c, d);
     }
 
 #pragma endregion Cost functions
@@ -269,17 +515,24 @@ struct solution_t {
         return (i - 1) % path.size();
     }
 
-    bool is_cost_correct() const {
-        int actual_cost = 0;
+    // Cost of the path computed from scratch
+    total_cost_t path_cost() const {
+        if (path.empty()) {
+            return 0;
+        }
+
+        total_cost_t actual_cost = 0;
         for (unsigned int i = 0; i < path.size() - 1; i++) {
             actual_cost +=
                 tsp->weights[path[i]] + tsp->adj_matrix(path[i], path[i + 1]);
         }
         actual_cost += tsp->weights[path.back()] +
                        tsp->adj_matrix(path.back(), path.front());
-        return actual_cost == cost;
+        return actual_cost;
     }
 
+    bool is_cost_correct() const { return path_cost() == cost; }
+
     bool is_valid() const {
         return std::unordered_set(path.begin(), path.end()).size() ==
                path.size();
@@ -309,14 +562,43 @@ struct operation_t {
 };
 
 struct timer_t {
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
+    std::chrono::time_point<std::chrono::steady_clock> start_time;
+    phase_times_t start_phases = {};
 
-    void start() { start_time = std::chrono::high_resolution_clock::now(); }
+    void start() { start_time = std::chrono::steady_clock::now(); }
 
-    int measure() {
-        auto end_time = std::chrono::high_resolution_clock::now();
+    // Elapsed whole milliseconds (for time limits)
+    int measure() const {
+        auto end_time = std::chrono::steady_clock::now();
         return std::chrono::duration_cast<std::chrono::milliseconds>(end_time -
                                                                      start_time)
             .count();
     }
+
+    int64_t measure_ns() const {
+        auto end_time = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end_time -
+                                                                    start_time)
+            .count();
+    }
+
+    // Elapsed milliseconds at nanosecond resolution
+    double measure_ms() const { return measure_ns() / 1e6; }
 };
+
+// Start timing and profiling a single run on the calling thread
+inline void start_run(timer_t &timer) {
+    trace_event("run", 'B');
+    timer.start_phases = profile_snapshot();
+    timer.start();
+}
+
+// Record the runtime and phase breakdown since start_run in the solution
+inline void finish_run(solution_t &solution, const timer_t &timer) {
+    solution.runtime_ms = timer.measure_ms();
+    phase_times_t phases = profile_snapshot();
+    for (unsigned int i = 0; i < PHASE_COUNT; i++) {
+        solution.phase_ns[i] = phases[i] - timer.start_phases[i];
+    }
+    trace_event("run", 'E');
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "common/checkpoint.cpp"
+#include "common/convergence.cpp"
+#include "common/counters.cpp"
+#include "common/parse.cpp"
+#include "common/pool.cpp"
+#include "common/sink.cpp"
+#include "common/trace.cpp"
+#include "journal.cpp"
+#include "solve.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Run found in the journal of an earlier, interrupted experiment
+struct resumed_run_t {
+    bool done;         // Otherwise `solution` is the best so far
+    double elapsed_ms; // Time spent on the run before the interruption
+    rng_t rng;
+    solution_t solution;
+};
+
+// Runs of one heuristic on one instance. Solutions go to the sinks as the
+// jobs finish, only their runtimes are kept.
+struct run_group_t {
+    heuristic_t heuristic;
+    bool write; // False for a calibration nobody asked the results of
+    unsigned int reps;
+    std::vector<std::vector<convergence_t>> traces; // By run
+    std::map<unsigned int, resumed_run_t> resumed;  // By run, read-only
+    std::atomic<unsigned int> remaining;
+
+    std::mutex mutex; // Guards everything below
+    counter_values_t counters = {};
+    running_stats_t runtimes;
+    std::ofstream csv_out, binary_out;
+    std::unique_ptr<result_sink_t> csv, binary;
+
+    run_group_t(heuristic_t heuristic, bool write, unsigned int reps)
+        : heuristic(heuristic), write(write), reps(reps), traces(reps),
+          remaining(reps) {}
+};
+
+// An instance is parsed once; its runs share the tsp and the tables
+struct experiment_instance_t {
+    std::string name;
+    tsp_t tsp;
+    instance_t inst;
+    std::optional<int> budget_ms; // Fixed or cached, otherwise calibrated
+    std::map<heuristic_t, std::unique_ptr<run_group_t>> groups;
+
+    experiment_instance_t(const std::string &name, tsp_t tsp)
+        : name(name), tsp(std::move(tsp)), inst(this->tsp, name),
+          budget_ms(known_budget_ms(this->tsp)), groups() {}
+};
+
+// Job graph of an experiment: one job per (instance, heuristic, run) on a
+// work-stealing pool. The BUDGETED heuristics of an instance are released
+// once its calibration group is done, unless their budget is known. Every
+// group writes its results as soon as its last run finishes. Finished runs
+// and the running best of the metaheuristics are journaled, so an
+// interrupted experiment can resume.
+struct experiment_t {
+    std::string output_dir;
+    bool binary; // Also write <prefix>.bin through a binary_sink_t
+    std::vector<std::unique_ptr<experiment_instance_t>> instances;
+    std::mutex output_mutex; // Guards stats, failed and the console
+    run_stats_t stats;
+    bool failed;
+    journal_t journal;
+    work_pool_t pool;
+
+    experiment_t(const std::string &output_dir, unsigned int jobs,
+                 bool binary = false)
+        : output_dir(output_dir), binary(binary), instances(), output_mutex(),
+          stats(), failed(false), journal(), pool(jobs) {}
+
+    bool add_instance(const std::string &fname,
+                      const std::vector<heuristic_t> &heuristics) {
+        std::ifstream in(fname);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open file: " << fname << std::endl;
+            return false;
+        }
+
+        std::unique_ptr<experiment_instance_t> exp;
+        try {
+            exp = std::make_unique<experiment_instance_t>(instance_of(fname),
+                                                          parse(in, fname));
+        } catch (const std::exception &e) {
+            std::cerr << "Failed to read " << fname << ": " << e.what()
+                      << std::endl;
+            return false;
+        }
+        bool budgeted = false;
+        for (heuristic_t heuristic : heuristics) {
+            exp->groups[heuristic] = std::make_unique<run_group_t>(
+                heuristic, true, repetitions(heuristic, exp->tsp));
+            budgeted |= heuristic_runs.at(heuristic).kind == BUDGETED;
+        }
+
+        if (budgeted && !exp->budget_ms.has_value() &&
+            !exp->groups.count(CALIBRATION_HEURISTIC)) {
+            exp->groups[CALIBRATION_HEURISTIC] = std::make_unique<run_group_t>(
+                CALIBRATION_HEURISTIC, false,
+                repetitions(CALIBRATION_HEURISTIC, exp->tsp));
+        }
+
+        instances.push_back(std::move(exp));
+        return true;
+    }
+
+    // Open the journal once all instances are added. With `resume` the runs
+    // of the existing journal are taken over (and its seed); finished ones
+    // are not run again, interrupted ones continue from their best.
+    bool start_journal(bool resume) {
+        std::string path = output_dir + JOURNAL_FILE;
+        std::optional<journal_end_t> end;
+        if (resume) {
+            end = read_journal(
+                path,
+                [this](const std::string &name) -> const tsp_t * {
+                    experiment_instance_t *exp = find_instance(name);
+                    return exp ? &exp->tsp : nullptr;
+                },
+                [this](const journal_record_t &record, solution_t &&solution) {
+                    resume_run(record, std::move(solution));
+                });
+        }
+        bool found = end.has_value();
+        // Invalid data is left alone: it may hide records worth recovering
+        if (found && !end->torn) {
+            std::cerr << "Invalid record at byte " << end->offset << " of "
+                      << path << ", not appending to it" << std::endl;
+            return false;
+        }
+
+        if (resume && !found) {
+            std::cerr << "No journal in " << output_dir << ", starting over"
+                      << std::endl;
+        } else if (found) {
+            unsigned int done = 0, interrupted = 0;
+            for (auto &exp : instances) {
+                for (auto &[heuristic, group] : exp->groups) {
+                    for (auto &[rep, run] : group->resumed) {
+                        (run.done ? done : interrupted)++;
+                    }
+                }
+            }
+            std::cout << "Resuming " << done << " finished and " << interrupted
+                      << " interrupted runs (seed " << rng_base_seed << ")"
+                      << std::endl;
+        }
+
+        // Drop a record torn by the interruption, or the records of this
+        // session would land after it, out of reach of the next resume
+        std::error_code error;
+        if (found) {
+            std::filesystem::resize_file(path, end->offset, error);
+        }
+        if (error || !journal.open(path, found)) {
+            std::cerr << "Failed to open " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Run everything and wait for it. Returns false if any output failed.
+    bool run() {
+        // Calibrations first, they gate the longest jobs
+        for (auto &exp : instances) {
+            if (calibrating(*exp)) {
+                submit(*exp, *exp->groups[CALIBRATION_HEURISTIC], 0);
+            }
+        }
+        for (auto &exp : instances) {
+            for (auto &[heuristic, group] : exp->groups) {
+                if (heuristic == CALIBRATION_HEURISTIC && calibrating(*exp)) {
+                    continue;
+                }
+                if (heuristic_runs.at(heuristic).kind != BUDGETED) {
+                    submit(*exp, *group, 0);
+                } else if (exp->budget_ms.has_value()) {
+                    submit(*exp, *group, exp->budget_ms.value());
+                }
+            }
+        }
+
+        pool.wait();
+        return !failed;
+    }
+
+  private:
+    // Whether the budget of the instance comes from its calibration group
+    static bool calibrating(const experiment_instance_t &exp) {
+        return !exp.budget_ms.has_value() &&
+               exp.groups.count(CALIBRATION_HEURISTIC);
+    }
+
+    experiment_instance_t *find_instance(const std::string &name) {
+        for (auto &exp : instances) {
+            if (exp->name == name) {
+                return exp.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // Later records of a run supersede earlier ones, except that a
+    // finished run stays finished
+    void resume_run(const journal_record_t &record, solution_t &&solution) {
+        experiment_instance_t &exp = *find_instance(record.instance);
+        auto group = exp.groups.find(heuristic_t(record.heuristic));
+        if (group == exp.groups.end() || record.rep >= group->second->reps) {
+            return;
+        }
+
+        std::map<unsigned int, resumed_run_t> &resumed =
+            group->second->resumed;
+        auto found = resumed.find(record.rep);
+        if (found != resumed.end() && found->second.done) {
+            return;
+        }
+        resumed.insert_or_assign(
+            record.rep, resumed_run_t{record.kind == JOURNAL_DONE,
+                                      record.elapsed_ms, record.rng,
+                                      std::move(solution)});
+    }
+
+    void submit(experiment_instance_t &exp, run_group_t &group,
+                int time_limit_ms) {
+        for (unsigned int rep = 0; rep < group.reps; rep++) {
+            pool.submit([this, &exp, &group, rep, time_limit_ms] {
+                run_job(exp, group, rep, time_limit_ms);
+            });
+        }
+    }
+
+    void run_job(experiment_instance_t &exp, run_group_t &group,
+                 unsigned int rep, int time_limit_ms) {
+        auto resumed = group.resumed.find(rep);
+        if (resumed != group.resumed.end() && resumed->second.done) {
+            finish_job(exp, group, rep, resumed->second.solution, {});
+            return;
+        }
+
+        counter_values_t start = thread_counters_snapshot();
+        std::vector<convergence_t> &log = convergence_log();
+        size_t traced = log.size();
+
+        // An interrupted run gets the rest of its budget
+        double elapsed_ms = 0;
+        checkpoint_t &state = checkpoint();
+        if (resumed != group.resumed.end()) {
+            elapsed_ms = resumed->second.elapsed_ms;
+            state.warm = resumed->second.solution;
+            state.warm_rng = resumed->second.rng;
+            time_limit_ms = std::max(0, time_limit_ms - int(elapsed_ms));
+        }
+
+        int64_t start_ns = now_ns();
+        state.last_ns = start_ns;
+        state.save = [&](const solution_t &best, const rng_t &rng) {
+            double ms = elapsed_ms + (now_ns() - start_ns) / 1e6;
+            journal.write(
+                {JOURNAL_BEST, exp.name, group.heuristic, rep, ms, rng}, best);
+        };
+
+        solution_t solution =
+            run_heuristic(exp.inst, group.heuristic, rep, time_limit_ms);
+        solution.runtime_ms += elapsed_ms;
+        state.save = nullptr;
+        state.warm.reset();
+        journal.write({JOURNAL_DONE, exp.name, group.heuristic, rep,
+                       solution.runtime_ms, rng()},
+                      solution);
+
+        group.traces[rep].assign(std::make_move_iterator(log.begin() + traced),
+                                 std::make_move_iterator(log.end()));
+        log.resize(traced);
+
+        counter_values_t end = thread_counters_snapshot();
+        for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+            end[i] -= start[i];
+        }
+        finish_job(exp, group, rep, solution, end);
+    }
+
+    void finish_job(experiment_instance_t &exp, run_group_t &group,
+                    unsigned int rep, const solution_t &solution,
+                    const counter_values_t &counters) {
+        {
+            std::lock_guard lock(group.mutex);
+            for (unsigned int i = 0; i < COUNTER_COUNT; i++) {
+                group.counters[i] += counters[i];
+            }
+            group.runtimes.push(solution.runtime_ms);
+            if (group.write) {
+                push_result(exp, group, rep, solution);
+            }
+        }
+
+        if (group.remaining.fetch_sub(1) == 1) {
+            finish_group(exp, group);
+        }
+    }
+
+    std::string prefix_of(const experiment_instance_t &exp,
+                          const run_group_t &group) const {
+        const std::string &name = heuristic_t_str.at(group.heuristic);
+        return output_dir + exp.name + "_" + name;
+    }
+
+    // Called with the group mutex held. The files are opened by the first
+    // run to finish, so rows land on disk in completion order.
+    void push_result(experiment_instance_t &exp, run_group_t &group,
+                     unsigned int rep, const solution_t &solution) {
+        scoped_trace_t trace("write results");
+        if (!group.csv) {
+            std::string prefix = prefix_of(exp, group);
+            group.csv_out.open(prefix + ".csv");
+            group.csv = std::make_unique<csv_sink_t>(group.csv_out);
+            if (binary) {
+                group.binary_out.open(prefix + ".bin", std::ios::binary);
+                group.binary =
+                    std::make_unique<binary_sink_t>(group.binary_out);
+            }
+        }
+
+        group.csv->push(rep, solution);
+        if (group.binary) {
+            group.binary->push(rep, solution);
+        }
+    }
+
+    // Runs on the worker that finished the last run of the group
+    void finish_group(experiment_instance_t &exp, run_group_t &group) {
+        if (group.heuristic == CALIBRATION_HEURISTIC && calibrating(exp)) {
+            int time_limit_ms = calibration_ms(group.runtimes);
+            remember_budget_ms(exp.inst, time_limit_ms);
+            for (auto &[heuristic, budgeted] : exp.groups) {
+                if (heuristic_runs.at(heuristic).kind == BUDGETED) {
+                    submit(exp, *budgeted, time_limit_ms);
+                }
+            }
+        }
+
+        if (group.write) {
+            write_group(exp, group);
+        }
+    }
+
+    void write_group(experiment_instance_t &exp, run_group_t &group) {
+        scoped_trace_t trace("write results");
+        const std::string &name = heuristic_t_str.at(group.heuristic);
+        std::string prefix = prefix_of(exp, group);
+
+        group.csv_out.close();
+        bool good = !group.csv_out.fail();
+        if (group.binary) {
+            group.binary_out.close();
+            good &= !group.binary_out.fail();
+        }
+
+        std::vector<convergence_t> traces;
+        for (std::vector<convergence_t> &run : group.traces) {
+            for (convergence_t &trace : run) {
+                traces.push_back(std::move(trace));
+            }
+        }
+        if (!traces.empty()) {
+            std::ofstream trace_out(prefix + "_convergence.csv");
+            write_convergence(trace_out, traces);
+        }
+
+        std::lock_guard lock(output_mutex);
+        stats[exp.name][name] = group.counters;
+        if (!good) {
+            std::cerr << "Failed to write " << prefix << ".csv" << std::endl;
+            failed = true;
+            return;
+        }
+        std::cout << "Results saved to " << prefix << ".csv" << std::endl;
+    }
+};
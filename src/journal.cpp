@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common/random.cpp"
+#include "common/sink.cpp"
+#include "common/types.cpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#define JOURNAL_MAGIC 0x4a505354 // "TSPJ"
+#define JOURNAL_VERSION 2
+#define JOURNAL_FILE "journal.bin"
+#define JOURNAL_MAX_NAME 4096 // Longest instance name a record may carry
+
+enum journal_kind_t : uint8_t {
+    JOURNAL_DONE = 1, // A finished run and its result
+    JOURNAL_BEST = 2  // The best solution so far of a run in flight
+};
+
+struct journal_record_t {
+    journal_kind_t kind;
+    std::string instance;
+    uint32_t heuristic;
+    uint32_t rep;
+    double elapsed_ms; // Time the run had spent when the record was written
+    rng_t rng;         // Generator state at that point
+};
+
+// Append-only binary log of an experiment: a header (magic, version, base
+// seed), then one record per finished run and per checkpoint of a run in
+// flight. Every record is flushed as it is written, so a killed experiment
+// loses at most the record being written.
+struct journal_t {
+    std::ofstream out;
+    std::mutex mutex;
+
+    // Start a new journal, or append to an existing one when resuming
+    bool open(const std::string &path, bool append) {
+        out.open(path, std::ios::binary |
+                           (append ? std::ios::app : std::ios::trunc));
+        if (out.is_open() && !append) {
+            write_binary<uint32_t>(out, JOURNAL_MAGIC);
+            write_binary<uint32_t>(out, JOURNAL_VERSION);
+            write_binary<uint64_t>(out, rng_base_seed.load());
+            out.flush();
+        }
+        return out.is_open();
+    }
+
+    void write(const journal_record_t &record, const solution_t &solution) {
+        std::lock_guard lock(mutex);
+        write_binary<uint8_t>(out, record.kind);
+        write_binary<uint32_t>(out, record.instance.size());
+        out.write(record.instance.data(), record.instance.size());
+        write_binary<uint32_t>(out, record.heuristic);
+        write_binary<uint32_t>(out, record.rep);
+        write_binary<double>(out, record.elapsed_ms);
+        for (uint64_t word : record.rng.s) {
+            write_binary<uint64_t>(out, word);
+        }
+        write_solution_binary(out, solution);
+        out.flush();
+    }
+};
+
+// Where replaying a journal stopped
+struct journal_end_t {
+    uint64_t offset; // Just past the last complete record
+    bool torn;       // Stopped by the end of the file, not by invalid data
+};
+
+// Replay a journal: set the base seed it was written with and hand every
+// complete record to fn(record, solution). `tsp_of` maps an instance name
+// to its tsp, or nullptr for instances no longer part of the experiment,
+// whose records are skipped. Stops at the first truncated or invalid
+// record. Returns where it stopped (a caller may cut a torn record off
+// before appending, but nothing past invalid data), or nothing if the
+// file is missing or is not a journal.
+std::optional<journal_end_t> read_journal(
+    const std::string &path,
+    const std::function<const tsp_t *(const std::string &)> &tsp_of,
+    const std::function<void(const journal_record_t &, solution_t &&)> &fn) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic, version;
+    uint64_t seed;
+    if (!read_binary(in, magic) || magic != JOURNAL_MAGIC ||
+        !read_binary(in, version) || version != JOURNAL_VERSION ||
+        !read_binary(in, seed)) {
+        return {};
+    }
+    seed_rng(seed);
+    uint64_t end = in.tellg();
+
+    journal_record_t record;
+    uint8_t kind;
+    uint32_t size;
+    while (read_binary(in, kind) && read_binary(in, size)) {
+        if ((kind != JOURNAL_DONE && kind != JOURNAL_BEST) ||
+            size > JOURNAL_MAX_NAME) {
+            break;
+        }
+        record.kind = journal_kind_t(kind);
+        record.instance.resize(size);
+        if (!in.read(record.instance.data(), size) ||
+            !read_binary(in, record.heuristic) ||
+            !read_binary(in, record.rep) ||
+            !read_binary(in, record.elapsed_ms)) {
+            break;
+        }
+
+        bool complete = true;
+        for (uint64_t &word : record.rng.s) {
+            complete &= read_binary(in, word);
+        }
+
+        if (!complete) {
+            break;
+        }
+
+        const tsp_t *tsp = tsp_of(record.instance);
+        if (tsp == nullptr) {
+            if (!skip_solution_binary(in)) {
+                break;
+            }
+            end = in.tellg();
+            continue;
+        }
+
+        std::optional<solution_t> solution = read_solution_binary(in, *tsp);
+        if (!solution.has_value()) {
+            break;
+        }
+        end = in.tellg();
+        fn(record, std::move(solution.value()));
+    }
+
+    return journal_end_t{end, in.eof()};
+}
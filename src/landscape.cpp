@@ -0,0 +1,210 @@
+#pragma once
+
+#include "common/pool.cpp"
+#include "common/random.cpp"
+#include "common/sink.cpp"
+#include "common/stats.cpp"
+#include "solve.cpp"
+#include "task8/similarities.cpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define LANDSCAPE_CHUNK 64       // Optima generated per pool job
+#define LANDSCAPE_RESERVOIR 1000 // Optima kept to compare the others with
+
+struct landscape_options_t {
+    heuristic_t heuristic = LOCAL_SEARCH_RANDOM_GREEDY_REVERSE;
+    unsigned int optima = 1000;
+    unsigned int reservoir = LANDSCAPE_RESERVOIR;
+    unsigned int pairs = 0; // Sampled per optimum, 0 for the whole reservoir
+    unsigned int jobs = 1;
+};
+
+// An optimum kept in the sample, with its sampling priority
+struct sampled_optimum_t {
+    uint64_t priority;
+    unsigned int idx;
+    similarity_key_t key;
+
+    bool operator<(const sampled_optimum_t &other) const {
+        return priority < other.priority;
+    }
+};
+
+// First pass: generate the optima on the pool and stream them to the
+// binary results file. Meanwhile keep the best one and a uniform sample
+// of `reservoir` optima: those of the lowest hashed index, so the sample
+// does not depend on the order the jobs finish in.
+struct landscape_pass_t {
+    std::mutex mutex;
+    binary_sink_t sink;
+    std::priority_queue<sampled_optimum_t> sample; // Max priority on top
+    std::optional<solution_t> best;
+    unsigned int best_idx = 0;
+
+    landscape_pass_t(std::ostream &os) : sink(os) {}
+
+    void push(const landscape_options_t &opts, unsigned int idx,
+              const solution_t &solution) {
+        uint64_t x = rng_base_seed.load() ^ idx;
+        uint64_t priority = splitmix64(x);
+
+        std::lock_guard lock(mutex);
+        sink.push(idx, solution);
+
+        if (sample.size() < opts.reservoir) {
+            sample.push({priority, idx, similarity_key_t(solution)});
+        } else if (opts.reservoir > 0 && priority < sample.top().priority) {
+            sample.pop();
+            sample.push({priority, idx, similarity_key_t(solution)});
+        }
+
+        if (!best.has_value() || solution.cost < best->cost ||
+            (solution.cost == best->cost && idx < best_idx)) {
+            best = solution;
+            best_idx = idx;
+        }
+    }
+};
+
+// Optimum number idx of the heuristic. PER_NODE heuristics are started
+// from every node in turn, each round on another seed.
+solution_t landscape_optimum(instance_t &inst, heuristic_t heuristic,
+                             unsigned int idx, int time_limit_ms) {
+    if (heuristic_runs.at(heuristic).kind != PER_NODE) {
+        return run_heuristic(inst, heuristic, idx, time_limit_ms);
+    }
+    return run_heuristic(inst, heuristic, idx % inst.tsp.n, 0,
+                         rng_base_seed.load() + idx / inst.tsp.n);
+}
+
+struct landscape_stats_t {
+    unsigned int optima = 0;
+    total_cost_t best_cost = 0;
+    running_correlation_t edges_best, nodes_best, avg_edges, avg_nodes;
+};
+
+// Generate the local optima of the instance into `optima_path`, then
+// stream them back, writing the similarities of each one (to the best and
+// on average to the sample) to `os` as CSV. Memory is bounded by the
+// sample, not by the number of optima.
+std::optional<landscape_stats_t> landscape(const tsp_t &tsp,
+                                           const std::string &name,
+                                           const landscape_options_t &opts,
+                                           const std::string &optima_path,
+                                           std::ostream &os) {
+    instance_t inst(tsp, name);
+    std::vector<sampled_optimum_t> sample;
+    std::optional<similarity_key_t> best_key;
+    landscape_stats_t stats;
+    {
+        std::ofstream out(optima_path, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open " << optima_path << std::endl;
+            return {};
+        }
+
+        int time_limit_ms = 0;
+        if (heuristic_runs.at(opts.heuristic).kind == BUDGETED) {
+            time_limit_ms = budget_ms(inst);
+        }
+
+        landscape_pass_t pass(out);
+        work_pool_t pool(opts.jobs);
+        for (unsigned int start = 0; start < opts.optima;
+             start += LANDSCAPE_CHUNK) {
+            unsigned int end = std::min(opts.optima, start + LANDSCAPE_CHUNK);
+            pool.submit([&, start, end] {
+                for (unsigned int idx = start; idx < end; idx++) {
+                    pass.push(opts, idx,
+                              landscape_optimum(inst, opts.heuristic, idx,
+                                                time_limit_ms));
+                }
+            });
+        }
+        pool.wait();
+
+        if (!pass.best.has_value() || !out.good()) {
+            return {};
+        }
+        best_key.emplace(pass.best.value());
+        stats.best_cost = pass.best->cost;
+        for (; !pass.sample.empty(); pass.sample.pop()) {
+            sample.push_back(pass.sample.top());
+        }
+    }
+
+    // Second pass, one optimum in memory at a time
+    std::ifstream in(optima_path, std::ios::binary);
+    uint32_t magic, version, phases;
+    if (!read_binary(in, magic) || magic != BINARY_RESULTS_MAGIC ||
+        !read_binary(in, version) || version != BINARY_RESULTS_VERSION ||
+        !read_binary(in, phases) || phases != PHASE_COUNT) {
+        std::cerr << "Failed to read back " << optima_path << std::endl;
+        return {};
+    }
+
+    os << "idx,cost,num_common_edges,num_common_nodes,avg_common_edges,"
+          "avg_common_nodes\n";
+    uint32_t idx;
+    std::optional<solution_t> solution;
+    rng_t sampler(rng_base_seed.load());
+    while (read_binary(in, idx) &&
+           (solution = read_solution_binary(in, tsp)).has_value()) {
+        similarity_key_t key(solution.value());
+        unsigned int edges_best = common_edges_similarity(key, *best_key);
+        unsigned int nodes_best = common_nodes_similarity(key, *best_key);
+
+        // Mean over the sample, or over `pairs` random members of it
+        double edges_sum = 0, nodes_sum = 0;
+        unsigned int compared = 0;
+        bool all = opts.pairs == 0 || opts.pairs >= sample.size();
+        unsigned int draws = all ? sample.size() : opts.pairs;
+        for (unsigned int k = 0; k < draws; k++) {
+            const sampled_optimum_t &other =
+                all ? sample[k] : sample[random_below(sampler, sample.size())];
+            if (other.idx == idx) {
+                continue;
+            }
+            edges_sum += common_edges_similarity(key, other.key);
+            nodes_sum += common_nodes_similarity(key, other.key);
+            compared++;
+        }
+        double avg_edges = compared ? edges_sum / compared : 0;
+        double avg_nodes = compared ? nodes_sum / compared : 0;
+
+        total_cost_t cost = solution->cost;
+        stats.optima++;
+        stats.edges_best.push(cost, edges_best);
+        stats.nodes_best.push(cost, nodes_best);
+        stats.avg_edges.push(cost, avg_edges);
+        stats.avg_nodes.push(cost, avg_nodes);
+        os << idx << "," << cost << "," << edges_best << "," << nodes_best
+           << "," << avg_edges << "," << avg_nodes << "\n";
+    }
+
+    return stats;
+}
+
+std::ostream &operator<<(std::ostream &os, const landscape_stats_t &stats) {
+    os << "Optima: " << stats.optima << std::endl;
+    os << "Best cost: " << stats.best_cost << std::endl;
+    os << "Correlation of the cost with" << std::endl;
+    os << "  common edges with the best: " << stats.edges_best.r()
+       << std::endl;
+    os << "  common nodes with the best: " << stats.nodes_best.r()
+       << std::endl;
+    os << "  mean common edges: " << stats.avg_edges.r() << std::endl;
+    os << "  mean common nodes: " << stats.avg_nodes.r() << std::endl;
+    return os;
+}
@@ -1,5 +1,5 @@
 #include "common/parse.cpp"
-#include "common/print.cpp"
+#include "common/sink.cpp"
 #include "common/types.cpp"
 #include "solve.cpp"
 #include <fstream>
@@ -18,11 +18,10 @@ int main() {
 
     for (auto &heur : {RANDOM}) {
         std::string heur_str = heuristic_t_str[heur];
-        std::vector solutions = solve(tsp, heur);
         std::ofstream out("../results/" + instance_name + "_" + heur_str +
                           ".csv");
-
-        out << solutions;
+        csv_sink_t sink(out);
+        solve(tsp, heur, sink);
     }
 
     return 0;
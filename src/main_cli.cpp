@@ -1,13 +1,30 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <optional>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
+#include "bench.cpp"
+#include "common/convergence.cpp"
+#include "common/counters.cpp"
+#include "common/generate.cpp"
 #include "common/parse.cpp"
-#include "common/print.cpp"
+#include "common/random.cpp"
+#include "common/sink.cpp"
+#include "common/trace.cpp"
+#include "experiment.cpp"
+#include "landscape.cpp"
+#include "regress.cpp"
+#include "serve.cpp"
 #include "solve.cpp"
 
 #define ERROR "\033[0;31m[ERROR]\033[0m"
@@ -24,30 +41,210 @@ std::optional<std::ifstream> open_file(const std::string &fname) {
     return in;
 }
 
-int experiment(const std::string &fname, const std::string &output_dir) {
+// The instance in the file, or nothing once the reason it could not be
+// read is reported
+std::optional<tsp_t> read_instance(const std::string &fname) {
     auto in = open_file(fname);
-
     if (!in.has_value()) {
-        return 1;
+        return {};
+    }
+    try {
+        return parse(in.value(), fname);
+    } catch (const std::exception &e) {
+        std::cerr << ERROR << " failed to read " << fname << ": " << e.what()
+                  << std::endl;
+        return {};
     }
+}
 
-    tsp_t tsp = parse(in.value());
-    std::string instance_name = fname.substr(fname.find_last_of("/\\") + 1);
-    instance_name = instance_name.substr(0, instance_name.find_last_of("."));
-    instance_name = output_dir + instance_name;
+std::optional<unsigned long long> parse_number(const char *arg) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0') {
+        return {};
+    }
+    return value;
+}
 
-    for (auto &[key, value] : heuristic_t_str) {
-        std::cout << "Running " << value << " heuristic" << std::endl;
+std::optional<double> parse_real(const char *arg) {
+    char *end = nullptr;
+    errno = 0;
+    double value = strtod(arg, &end);
+    if (errno != 0 || end == arg || *end != '\0') {
+        return {};
+    }
+    return value;
+}
+
+// Enum value with the given name in one of the *_str maps
+template <typename enum_t>
+std::optional<enum_t> find_by_name(const std::map<enum_t, std::string> &names,
+                                   const std::string &name) {
+    for (auto &[key, value] : names) {
+        if (value == name) {
+            return key;
+        }
+    }
+    return {};
+}
 
-        std::vector solutions = solve(tsp, key);
-        std::string path = instance_name + "_" + value + ".csv";
-        std::ofstream out(path);
+// Quoted, comma-separated names of one of the *_str maps, for help texts
+template <typename enum_t>
+std::string names_of(const std::map<enum_t, std::string> &names) {
+    std::string result = "";
+    unsigned int i = 0;
+    for (auto &[key, value] : names) {
+        result += "\"" + value + "\"";
+        if (++i < names.size()) {
+            result += ", ";
+        }
+    }
+    return result;
+}
 
-        out << solutions;
+std::vector<std::string> split(const std::string &list, char sep = ',') {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        items.push_back(item);
+    }
+    return items;
+}
 
-        std::cout << "Results saved to " << path << std::endl;
+// Handle --seed <number>, shared by the solving commands. Returns false on
+// a malformed argument.
+bool parse_seed(int argc, char **argv, int &i) {
+    if (i + 1 >= argc) {
+        std::cerr << ERROR << " missing argument for --seed" << std::endl;
+        return false;
     }
 
+    auto seed = parse_number(argv[i + 1]);
+    if (!seed.has_value()) {
+        std::cerr << ERROR << " invalid seed: " << argv[i + 1] << std::endl;
+        return false;
+    }
+
+    seed_rng(seed.value());
+    i++;
+    return true;
+}
+
+// Handle --time-limit <ms> and --repetitions <number>, shared by the
+// solving commands
+bool parse_budget(int argc, char **argv, int &i) {
+    bool time_limit = strcmp(argv[i], "--time-limit") == 0;
+    auto value = i + 1 < argc ? parse_number(argv[i + 1])
+                              : std::optional<unsigned long long>();
+    if (!value.has_value() || value.value() == 0 ||
+        value.value() > (time_limit ? INT_MAX : 1000000)) {
+        std::cerr << ERROR << " invalid value for " << argv[i] << std::endl;
+        return false;
+    }
+
+    if (time_limit) {
+        fixed_time_limit_ms = value.value();
+    } else {
+        run_repetitions = value.value();
+    }
+    i++;
+    return true;
+}
+
+// Handle --destroy-fraction <share>, shared by the solving commands
+bool parse_destroy_fraction(int argc, char **argv, int &i) {
+    auto value = i + 1 < argc ? parse_real(argv[i + 1])
+                              : std::optional<double>();
+    if (!value.has_value() || !(value.value() > 0 && value.value() < 1)) {
+        std::cerr << ERROR << " invalid value for " << argv[i] << std::endl;
+        return false;
+    }
+
+    lns_destroy_fraction = value.value();
+    i++;
+    return true;
+}
+
+void print_budget_help(const std::string &calibration_default) {
+    std::cout << "\t--time-limit number\tTime limit of the budgeted "
+                 "heuristics in ms (default calibrated per instance)"
+              << std::endl;
+    std::cout << "\t--repetitions number\tRuns of the non-constructive "
+                 "heuristics (default "
+              << REPETITIONS << ")" << std::endl;
+    std::cout << "\t--calibration string\tFile caching the calibrated time "
+                 "limits across runs (default "
+              << calibration_default << ")" << std::endl;
+    std::cout << "\t--destroy-fraction number\tShare of the path the LNS "
+                 "destroy step removes (default "
+              << DESTROY_FRACTION << ")" << std::endl;
+}
+
+// Handle --stats <file>, shared by the solving commands
+bool parse_stats(int argc, char **argv, int &i, std::string &stats_path) {
+    if (i + 1 >= argc) {
+        std::cerr << ERROR << " missing argument for --stats" << std::endl;
+        return false;
+    }
+
+    if (!stats_enabled) {
+        std::cerr << "Warning: built without TSP_STATS, all counters will be 0"
+                  << std::endl;
+    }
+
+    stats_path = argv[++i];
+    return true;
+}
+
+// Handle --trace <file>, shared by the solving commands
+bool parse_trace(int argc, char **argv, int &i, std::string &trace_path) {
+    if (i + 1 >= argc) {
+        std::cerr << ERROR << " missing argument for --trace" << std::endl;
+        return false;
+    }
+
+    trace_path = argv[++i];
+    tracing_enabled = true;
+    return true;
+}
+
+int save_trace(const std::string &path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << ERROR << " failed to open file: " << path << std::endl;
+        return 1;
+    }
+
+    write_trace(out);
+    std::cout << "Trace saved to " << path << std::endl;
+    return 0;
+}
+
+int write_stats(const std::string &path, const run_stats_t &stats) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << ERROR << " failed to open file: " << path << std::endl;
+        return 1;
+    }
+
+    out << "{";
+    int i = 0;
+    for (const auto &[instance, heuristics] : stats) {
+        out << (i++ > 0 ? "," : "") << std::endl
+            << "  \"" << instance << "\": {";
+        int j = 0;
+        for (const auto &[heuristic, values] : heuristics) {
+            out << (j++ > 0 ? "," : "") << std::endl
+                << "    \"" << heuristic << "\": ";
+            write_counters_json(out, values, "    ");
+        }
+        out << std::endl << "  }";
+    }
+    out << std::endl << "}" << std::endl;
+
+    std::cout << "Stats saved to " << path << std::endl;
     return 0;
 }
 
@@ -61,6 +258,10 @@ int parse_main(int argc, char **argv) {
     if (strcmp(argv[2], "--help") == 0) {
         std::cout << "usage: " << argv[0] << " parse <file> [options]"
                   << std::endl;
+        std::cout << "<file> holds x;y;weight lines, or a TSPLIB instance "
+                     "when it ends in .tsp (weights from NODE_WEIGHT_SECTION "
+                     "or <name>.weights)"
+                  << std::endl;
         std::cout << "options:" << std::endl;
         std::cout << "\t-v, --verbose\tPrint additional information"
                   << std::endl;
@@ -81,12 +282,11 @@ int parse_main(int argc, char **argv) {
         return 1;
     }
 
-    auto in = open_file(fname);
-    if (!in.has_value()) {
+    std::optional<tsp_t> instance = read_instance(fname);
+    if (!instance.has_value()) {
         return 1;
     }
-
-    tsp_t tsp = parse(in.value());
+    const tsp_t &tsp = instance.value();
 
     std::cout << tsp.n << " nodes" << std::endl;
 
@@ -105,14 +305,7 @@ int solve_main(int argc, char **argv) {
     }
 
     if (strcmp(argv[2], "--help") == 0) {
-        std::string heuristics = "";
-        int i = 0;
-        for (auto &[key, value] : heuristic_t_str) {
-            heuristics += "\"" + value + "\"";
-            if (++i < heuristic_t_str.size()) {
-                heuristics += ", ";
-            }
-        }
+        std::string heuristics = names_of(heuristic_t_str);
 
         std::cout << "usage: " << argv[0] << " solve <file> [options]"
                   << std::endl;
@@ -120,10 +313,30 @@ int solve_main(int argc, char **argv) {
         std::cout << "\t--heuristic string\tHeuristic to use (" + heuristics +
                          ") (default \"random\")"
                   << std::endl;
+        std::cout << "\t--seed number\tSeed of the random number generator "
+                     "(default random)"
+                  << std::endl;
+        std::cout << "\t--stats string\tWrite the hot-path counters as JSON "
+                     "(needs a -DTSP_STATS build)"
+                  << std::endl;
+        std::cout << "\t--trace string\tWrite a Chrome trace of the solver "
+                     "phases (open in Perfetto)"
+                  << std::endl;
+        print_budget_help("./results/calibration.csv");
+        std::cout << "\t--csv string\tAlso stream the runs to a results CSV"
+                  << std::endl;
+        std::cout << "\t--binary string\tAlso stream the runs to a binary "
+                     "results file"
+                  << std::endl;
         return 0;
     }
 
     std::string fname = argv[2];
+    std::string stats_path = "";
+    std::string trace_path = "";
+    std::string csv_path = "";
+    std::string binary_path = "";
+    std::string calibration_path = "./results/calibration.csv";
     heuristic_t heuristic = RANDOM;
 
     int i = 2;
@@ -135,21 +348,67 @@ int solve_main(int argc, char **argv) {
                 return 1;
             }
 
-            bool heuristic_flag = false;
-            for (auto &[key, value] : heuristic_t_str) {
-                if (argv[i + 1] == value) {
-                    heuristic = key;
-                    heuristic_flag = true;
-                    break;
-                }
+            auto found = find_by_name(heuristic_t_str, argv[i + 1]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " unknown heuristic: " << argv[i + 1]
+                          << std::endl;
+                return 1;
             }
 
-            if (!heuristic_flag) {
-                std::cerr << ERROR << " unknown heuristic: " << argv[i + 1]
+            heuristic = found.value();
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--stats") == 0) {
+            if (!parse_stats(argc, argv, i, stats_path)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--trace") == 0) {
+            if (!parse_trace(argc, argv, i, trace_path)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--time-limit") == 0 ||
+            strcmp(argv[i], "--repetitions") == 0) {
+            if (!parse_budget(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--destroy-fraction") == 0) {
+            if (!parse_destroy_fraction(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--csv") == 0 || strcmp(argv[i], "--binary") == 0 ||
+            strcmp(argv[i], "--calibration") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << ERROR << " missing argument for " << argv[i]
                           << std::endl;
                 return 1;
             }
 
+            std::string &path = strcmp(argv[i], "--csv") == 0 ? csv_path
+                                : strcmp(argv[i], "--binary") == 0
+                                    ? binary_path
+                                    : calibration_path;
+            path = argv[i + 1];
             i++;
             continue;
         }
@@ -158,14 +417,54 @@ int solve_main(int argc, char **argv) {
         return 1;
     }
 
-    auto in = open_file(fname);
-    if (!in.has_value()) {
+    std::optional<tsp_t> instance = read_instance(fname);
+    if (!instance.has_value()) {
         return 1;
     }
+    const tsp_t &tsp = instance.value();
+
+    // Every run is printed and written out as soon as it finishes
+    summary_sink_t summary(std::cout);
+    std::vector<result_sink_t *> sinks = {&summary};
+    std::ofstream csv_out, binary_out;
+    std::optional<csv_sink_t> csv;
+    std::optional<binary_sink_t> binary;
+    if (!csv_path.empty()) {
+        csv_out.open(csv_path);
+        if (!csv_out.is_open()) {
+            std::cerr << ERROR << " failed to open file: " << csv_path
+                      << std::endl;
+            return 1;
+        }
+        sinks.push_back(&csv.emplace(csv_out));
+    }
+    if (!binary_path.empty()) {
+        binary_out.open(binary_path, std::ios::binary);
+        if (!binary_out.is_open()) {
+            std::cerr << ERROR << " failed to open file: " << binary_path
+                      << std::endl;
+            return 1;
+        }
+        sinks.push_back(&binary.emplace(binary_out));
+    }
+    multi_sink_t sink(sinks);
 
-    tsp_t tsp = parse(in.value());
-    std::vector solutions = solve(tsp, heuristic);
-    std::cout << solutions;
+    calibration_cache_t cache(calibration_path);
+    calibration_cache = &cache;
+
+    counter_values_t start = counters_snapshot();
+    solve(tsp, heuristic, sink, instance_of(fname));
+    counter_values_t counters = counters_since(start);
+
+    if (!trace_path.empty() && save_trace(trace_path) != 0) {
+        return 1;
+    }
+
+    if (!stats_path.empty()) {
+        run_stats_t stats;
+        stats[instance_of(fname)][heuristic_t_str[heuristic]] = counters;
+        return write_stats(stats_path, stats);
+    }
 
     return 0;
 }
@@ -183,11 +482,39 @@ int experiment_main(int argc, char **argv) {
         std::cout
             << "\t-o, --output string\tOutput directory (default ./results/)"
             << std::endl;
+        std::cout << "\t-j, --jobs number\tRuns to execute in parallel "
+                     "(default 1)"
+                  << std::endl;
+        std::cout << "\t--binary\tAlso write every group to a binary "
+                     "results file (.bin)"
+                  << std::endl;
+        print_budget_help("<output>/calibration.csv");
+        std::cout << "\t--resume\tSkip the runs finished by an interrupted "
+                     "experiment in the same output directory and continue "
+                     "its unfinished metaheuristics from their best so far "
+                     "(uses the seed of the journal)"
+                  << std::endl;
+        std::cout << "\t--seed number\tSeed of the random number generator "
+                     "(default random)"
+                  << std::endl;
+        std::cout << "\t--stats string\tWrite the hot-path counters as JSON "
+                     "(needs a -DTSP_STATS build)"
+                  << std::endl;
+        std::cout << "\t--trace string\tWrite a Chrome trace of the solver "
+                     "phases (open in Perfetto)"
+                  << std::endl;
         return 0;
     }
 
     std::string fname = argv[2];
     std::string output_dir = "./results/";
+    std::string stats_path = "";
+    std::string trace_path = "";
+    unsigned int jobs = 1;
+    std::string calibration_path = "";
+    bool binary = false;
+    bool resume = false;
+    convergence_enabled = true;
 
     int i = 2;
     while (++i < argc) {
@@ -198,7 +525,7 @@ int experiment_main(int argc, char **argv) {
                 return 1;
             }
 
-            std::string output_dir = argv[i + 1];
+            output_dir = argv[i + 1];
             if (output_dir.back() != '/') {
                 output_dir += '/';
             }
@@ -207,26 +534,677 @@ int experiment_main(int argc, char **argv) {
             continue;
         }
 
+        if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            auto value = i + 1 < argc ? parse_number(argv[i + 1])
+                                      : std::optional<unsigned long long>();
+            if (!value.has_value() || value.value() == 0 ||
+                value.value() > 1024) {
+                std::cerr << ERROR << " invalid number of jobs" << std::endl;
+                return 1;
+            }
+
+            jobs = value.value();
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--time-limit") == 0 ||
+            strcmp(argv[i], "--repetitions") == 0) {
+            if (!parse_budget(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--destroy-fraction") == 0) {
+            if (!parse_destroy_fraction(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--calibration") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << ERROR << " missing argument for --calibration"
+                          << std::endl;
+                return 1;
+            }
+
+            calibration_path = argv[++i];
+            continue;
+        }
+
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--stats") == 0) {
+            if (!parse_stats(argc, argv, i, stats_path)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--trace") == 0) {
+            if (!parse_trace(argc, argv, i, trace_path)) {
+                return 1;
+            }
+            continue;
+        }
+
         std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
         return 1;
     }
 
+    std::vector<heuristic_t> heuristics;
+    for (auto &[key, value] : heuristic_t_str) {
+        heuristics.push_back(key);
+    }
+
+    std::vector<std::string> fnames;
     if (std::filesystem::is_directory(fname)) {
         for (const auto &entry : std::filesystem::directory_iterator(fname)) {
-            if (!entry.is_regular_file()) {
-                continue;
+            if (entry.is_regular_file() &&
+                is_instance_file(entry.path().string())) {
+                fnames.push_back(entry.path().string());
             }
+        }
+        std::sort(fnames.begin(), fnames.end());
+    } else {
+        fnames.push_back(fname);
+    }
+
+    calibration_cache_t cache(calibration_path.empty()
+                                  ? output_dir + "calibration.csv"
+                                  : calibration_path);
+    calibration_cache = &cache;
+
+    experiment_t experiment(output_dir, jobs, binary);
+    for (const std::string &instance : fnames) {
+        if (!experiment.add_instance(instance, heuristics)) {
+            return 1;
+        }
+    }
+    if (!experiment.start_journal(resume)) {
+        return 1;
+    }
+
+    std::cout << "Running " << heuristics.size() << " heuristics on "
+              << fnames.size() << " instance(s) with " << jobs << " job(s)"
+              << std::endl;
+    bool ok = experiment.run();
+
+    if (!trace_path.empty() && save_trace(trace_path) != 0) {
+        return 1;
+    }
+
+    if (!stats_path.empty() && write_stats(stats_path, experiment.stats)) {
+        return 1;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int generate_main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << ERROR << " usage: " << argv[0]
+                  << " generate <file> [options]" << std::endl;
+        return 1;
+    }
+
+    if (strcmp(argv[2], "--help") == 0) {
+        std::cout << "usage: " << argv[0] << " generate <file> [options]"
+                  << std::endl;
+        std::cout << "options:" << std::endl;
+        std::cout << "\t-n, --size number\tNumber of nodes (default 200)"
+                  << std::endl;
+        std::cout << "\t--layout string\tNode layout (" +
+                         names_of(layout_t_str) + ") (default \"uniform\")"
+                  << std::endl;
+        std::cout << "\t--weights string\tWeight distribution (" +
+                         names_of(weight_dist_t_str) +
+                         ") (default \"uniform\")"
+                  << std::endl;
+        std::cout << "\t--seed number\tSeed of the random number generator "
+                     "(default random)"
+                  << std::endl;
+        return 0;
+    }
+
+    std::string fname = argv[2];
+    unsigned int n = 200;
+    layout_t layout = UNIFORM;
+    weight_dist_t weights = WEIGHT_UNIFORM;
 
-            int result = experiment(entry.path().string(), output_dir);
-            if (result != 0) {
-                return result;
+    int i = 2;
+    while (++i < argc) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
             }
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << ERROR << " missing argument for " << argv[i]
+                      << std::endl;
+            return 1;
         }
 
+        if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--size") == 0) {
+            auto size = parse_number(argv[++i]);
+            if (!size.has_value() || size.value() < 3 ||
+                size.value() > UINT32_MAX) {
+                std::cerr << ERROR << " invalid size: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+            n = size.value();
+            continue;
+        }
+
+        if (strcmp(argv[i], "--layout") == 0) {
+            auto found = find_by_name(layout_t_str, argv[++i]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " unknown layout: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+            layout = found.value();
+            continue;
+        }
+
+        if (strcmp(argv[i], "--weights") == 0) {
+            auto found = find_by_name(weight_dist_t_str, argv[++i]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " unknown weight distribution: "
+                          << argv[i] << std::endl;
+                return 1;
+            }
+            weights = found.value();
+            continue;
+        }
+
+        std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(fname);
+    if (!out.is_open()) {
+        std::cerr << ERROR << " failed to open file: " << fname << std::endl;
+        return 1;
+    }
+
+    write_nodes(out, generate_nodes(n, layout, weights));
+    std::cout << n << " nodes saved to " << fname << std::endl;
+
+    return 0;
+}
+
+int bench_main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[2], "--help") == 0) {
+        std::cout << "usage: " << argv[0] << " bench [options]" << std::endl;
+        std::cout << "options:" << std::endl;
+        std::cout << "\t--sizes list\tComma-separated instance sizes "
+                     "(default 200,500,1000,2000)"
+                  << std::endl;
+        std::cout << "\t--heuristics list\tComma-separated heuristics "
+                     "(default random,nn_end,greedy_cycle)"
+                  << std::endl;
+        std::cout << "\t--layout string\tNode layout (" +
+                         names_of(layout_t_str) + ") (default \"uniform\")"
+                  << std::endl;
+        std::cout << "\t--weights string\tWeight distribution (" +
+                         names_of(weight_dist_t_str) +
+                         ") (default \"uniform\")"
+                  << std::endl;
+        std::cout << "\t-o, --output string\tOutput CSV file (default STDOUT)"
+                  << std::endl;
+        std::cout << "\t--seed number\tSeed of the random number generator "
+                     "(default random)"
+                  << std::endl;
+        return 0;
+    }
+
+    std::vector<unsigned int> sizes = {200, 500, 1000, 2000};
+    std::vector<heuristic_t> heuristics = {RANDOM, NN_END, GREEDY_CYCLE};
+    layout_t layout = UNIFORM;
+    weight_dist_t weights = WEIGHT_UNIFORM;
+    std::string output = "";
+
+    int i = 1;
+    while (++i < argc) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << ERROR << " missing argument for " << argv[i]
+                      << std::endl;
+            return 1;
+        }
+
+        if (strcmp(argv[i], "--sizes") == 0) {
+            sizes.clear();
+            for (const std::string &item : split(argv[++i])) {
+                auto size = parse_number(item.c_str());
+                if (!size.has_value() || size.value() < 3 ||
+                    size.value() > UINT32_MAX) {
+                    std::cerr << ERROR << " invalid size: " << item
+                              << std::endl;
+                    return 1;
+                }
+                sizes.push_back(size.value());
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--heuristics") == 0) {
+            heuristics.clear();
+            for (const std::string &item : split(argv[++i])) {
+                auto found = find_by_name(heuristic_t_str, item);
+                if (!found.has_value()) {
+                    std::cerr << ERROR << " unknown heuristic: " << item
+                              << std::endl;
+                    return 1;
+                }
+                heuristics.push_back(found.value());
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--layout") == 0) {
+            auto found = find_by_name(layout_t_str, argv[++i]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " unknown layout: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+            layout = found.value();
+            continue;
+        }
+
+        if (strcmp(argv[i], "--weights") == 0) {
+            auto found = find_by_name(weight_dist_t_str, argv[++i]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " unknown weight distribution: "
+                          << argv[i] << std::endl;
+                return 1;
+            }
+            weights = found.value();
+            continue;
+        }
+
+        if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) {
+            output = argv[++i];
+            continue;
+        }
+
+        std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
+        return 1;
+    }
+
+    if (output.empty()) {
+        return bench(sizes, heuristics, layout, weights, std::cout);
+    }
+
+    std::ofstream out(output);
+    if (!out.is_open()) {
+        std::cerr << ERROR << " failed to open file: " << output << std::endl;
+        return 1;
+    }
+
+    return bench(sizes, heuristics, layout, weights, out);
+}
+
+int regress_main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << ERROR << " usage: " << argv[0]
+                  << " regress <file> [options]" << std::endl;
+        return 1;
+    }
+
+    if (strcmp(argv[2], "--help") == 0) {
+        std::cout << "usage: " << argv[0] << " regress <file> [options]"
+                  << std::endl;
+        std::cout << "Reruns the heuristics on the instance (or every "
+                     "instance in the directory) and exits with 1 if cost or "
+                     "runtime got significantly worse than the baseline, or "
+                     "if the fused arrival costs disagree with the unfused "
+                     "formulas"
+                  << std::endl;
+        std::cout << "options:" << std::endl;
+        std::cout << "\t-b, --baseline string\tDirectory of the baseline "
+                     "CSVs (default ./results/)"
+                  << std::endl;
+        std::cout << "\t--heuristics list\tComma-separated heuristics "
+                     "(default all with a baseline)"
+                  << std::endl;
+        std::cout << "\t--alpha number\tSignificance level of the "
+                     "Mann-Whitney U test (default "
+                  << REGRESS_ALPHA << ")" << std::endl;
+        std::cout << "\t--threshold number\tTolerated relative slowdown of "
+                     "the median runtime (default "
+                  << REGRESS_TIME_THRESHOLD << ")" << std::endl;
+        std::cout << "\t--cost-threshold number\tTolerated relative increase "
+                     "of the median cost (default "
+                  << REGRESS_COST_THRESHOLD << ")" << std::endl;
+        std::cout << "\t--seed number\tSeed of the reruns (default 0)"
+                  << std::endl;
+        return 0;
+    }
+
+    std::string fname = argv[2];
+    regress_options_t opts;
+
+    int i = 2;
+    while (++i < argc) {
+        if (i + 1 >= argc) {
+            std::cerr << ERROR << " missing argument for " << argv[i]
+                      << std::endl;
+            return 1;
+        }
+
+        if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) {
+            opts.baseline_dir = argv[++i];
+            if (opts.baseline_dir.back() != '/') {
+                opts.baseline_dir += '/';
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--heuristics") == 0) {
+            for (const std::string &item : split(argv[++i])) {
+                auto found = find_by_name(heuristic_t_str, item);
+                if (!found.has_value()) {
+                    std::cerr << ERROR << " unknown heuristic: " << item
+                              << std::endl;
+                    return 1;
+                }
+                opts.heuristics.push_back(found.value());
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--seed") == 0) {
+            auto seed = parse_number(argv[++i]);
+            if (!seed.has_value()) {
+                std::cerr << ERROR << " invalid seed: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+            opts.seed = seed.value();
+            continue;
+        }
+
+        double *target = nullptr;
+        if (strcmp(argv[i], "--alpha") == 0) {
+            target = &opts.alpha;
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            target = &opts.time_threshold;
+        } else if (strcmp(argv[i], "--cost-threshold") == 0) {
+            target = &opts.cost_threshold;
+        } else {
+            std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        auto value = parse_real(argv[++i]);
+        if (!value.has_value() || value.value() < 0) {
+            std::cerr << ERROR << " invalid number: " << argv[i] << std::endl;
+            return 1;
+        }
+        *target = value.value();
+    }
+
+    std::vector<std::string> instances;
+    if (std::filesystem::is_directory(fname)) {
+        for (const auto &entry : std::filesystem::directory_iterator(fname)) {
+            if (entry.is_regular_file() &&
+                is_instance_file(entry.path().string())) {
+                instances.push_back(entry.path().string());
+            }
+        }
+        std::sort(instances.begin(), instances.end());
+    } else {
+        instances.push_back(fname);
+    }
+
+    write_regress_header(std::cout);
+    unsigned int regressions = 0;
+    for (const std::string &instance : instances) {
+        regressions += regress(instance, opts, std::cout);
+    }
+
+    if (regressions > 0) {
+        std::cerr << ERROR << " " << regressions << " regression(s) found"
+                  << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int serve_main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[2], "--help") == 0) {
+        std::cout << "usage: " << argv[0] << " serve [options]" << std::endl;
+        std::cout << "Answers line-delimited JSON solve requests from STDIN "
+                     "(or a socket) until it closes, keeping the instances "
+                     "in memory between requests"
+                  << std::endl;
+        std::cout << "options:" << std::endl;
+        std::cout << "\t--socket string\tListen on a Unix domain socket "
+                     "instead of STDIN"
+                  << std::endl;
+        std::cout << "\t-j, --jobs number\tRequests to solve in parallel "
+                     "(default 1)"
+                  << std::endl;
+        std::cout << "\t--cache number\tInstances to keep in memory "
+                     "(default "
+                  << SERVE_CACHE_INSTANCES << ")" << std::endl;
+        std::cout << "\t--seed number\tSeed of requests that set none "
+                     "(default random)"
+                  << std::endl;
+        return 0;
+    }
+
+    std::string socket_path = "";
+    unsigned int jobs = 1;
+    unsigned int capacity = SERVE_CACHE_INSTANCES;
+
+    int i = 1;
+    while (++i < argc) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << ERROR << " missing argument for " << argv[i]
+                      << std::endl;
+            return 1;
+        }
+
+        if (strcmp(argv[i], "--socket") == 0) {
+            socket_path = argv[++i];
+            continue;
+        }
+
+        bool is_jobs =
+            strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0;
+        if (is_jobs || strcmp(argv[i], "--cache") == 0) {
+            auto value = parse_number(argv[i + 1]);
+            if (!value.has_value() || value.value() == 0 ||
+                value.value() > 1024) {
+                std::cerr << ERROR << " invalid value for " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+
+            (is_jobs ? jobs : capacity) = value.value();
+            i++;
+            continue;
+        }
+
+        std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
+        return 1;
+    }
+
+    server_t server(jobs, capacity);
+    if (socket_path.empty()) {
+        server.serve_stream(std::cin, std::cout);
         return 0;
     }
+    return server.serve_socket(socket_path) ? 0 : 1;
+}
+
+int landscape_main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << ERROR << " usage: " << argv[0]
+                  << " landscape <file> [options]" << std::endl;
+        return 1;
+    }
+
+    if (strcmp(argv[2], "--help") == 0) {
+        std::string heuristics = names_of(heuristic_t_str);
+
+        std::cout << "usage: " << argv[0] << " landscape <file> [options]"
+                  << std::endl;
+        std::cout << "Generates local optima and correlates their cost with "
+                     "their similarity to the best one and to the others"
+                  << std::endl;
+        std::cout << "options:" << std::endl;
+        std::cout << "\t-o, --output string\tOutput directory (default "
+                     "./results/)"
+                  << std::endl;
+        std::cout << "\t--heuristic string\tHeuristic producing the optima ("
+                  << heuristics << ") (default \"local_search_random_greedy_"
+                  << "reverse\")" << std::endl;
+        std::cout << "\t--optima number\tOptima to generate (default 1000)"
+                  << std::endl;
+        std::cout << "\t--sample number\tOptima kept to compare the others "
+                     "with (default "
+                  << LANDSCAPE_RESERVOIR << ")" << std::endl;
+        std::cout << "\t--pairs number\tRandom comparisons per optimum "
+                     "(default 0, the whole sample)"
+                  << std::endl;
+        std::cout << "\t-j, --jobs number\tOptima to generate in parallel "
+                     "(default 1)"
+                  << std::endl;
+        std::cout << "\t--seed number\tSeed of the random number generator "
+                     "(default random)"
+                  << std::endl;
+        return 0;
+    }
+
+    std::string fname = argv[2];
+    std::string output_dir = "./results/";
+    landscape_options_t opts;
+
+    int i = 2;
+    while (++i < argc) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            if (!parse_seed(argc, argv, i)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << ERROR << " missing argument for " << argv[i]
+                      << std::endl;
+            return 1;
+        }
+
+        if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) {
+            output_dir = argv[++i];
+            if (output_dir.back() != '/') {
+                output_dir += '/';
+            }
+            continue;
+        }
+
+        if (strcmp(argv[i], "--heuristic") == 0) {
+            auto found = find_by_name(heuristic_t_str, argv[i + 1]);
+            if (!found.has_value()) {
+                std::cerr << ERROR << " invalid heuristic: " << argv[i + 1]
+                          << std::endl;
+                return 1;
+            }
+
+            opts.heuristic = found.value();
+            i++;
+            continue;
+        }
+
+        unsigned int *target = nullptr;
+        if (strcmp(argv[i], "--optima") == 0) {
+            target = &opts.optima;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            target = &opts.reservoir;
+        } else if (strcmp(argv[i], "--pairs") == 0) {
+            target = &opts.pairs;
+        } else if (strcmp(argv[i], "-j") == 0 ||
+                   strcmp(argv[i], "--jobs") == 0) {
+            target = &opts.jobs;
+        } else {
+            std::cerr << ERROR << " unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        auto value = parse_number(argv[i + 1]);
+        bool may_be_zero = target == &opts.pairs;
+        if (!value.has_value() || (value.value() == 0 && !may_be_zero) ||
+            value.value() > 100000000) {
+            std::cerr << ERROR << " invalid value for " << argv[i]
+                      << std::endl;
+            return 1;
+        }
+
+        *target = value.value();
+        i++;
+    }
 
-    return experiment(fname, output_dir);
+    std::optional<tsp_t> instance = read_instance(fname);
+    if (!instance.has_value()) {
+        return 1;
+    }
+    const tsp_t &tsp = instance.value();
+    std::string name = instance_of(fname);
+    std::string prefix = output_dir + name + "_landscape";
+    std::ofstream out(prefix + ".csv");
+    if (!out.is_open()) {
+        std::cerr << ERROR << " failed to open file: " << prefix << ".csv"
+                  << std::endl;
+        return 1;
+    }
+
+    auto stats = landscape(tsp, name, opts, prefix + ".bin", out);
+    if (!stats.has_value() || !out.good()) {
+        return 1;
+    }
+
+    std::cout << stats.value();
+    std::cout << "Results saved to " << prefix << ".csv" << std::endl;
+    return 0;
 }
 
 int main(int argc, char **argv) {
@@ -241,6 +1219,17 @@ int main(int argc, char **argv) {
         std::cout << "\tsolve\t\tSolve the TSP problem" << std::endl;
         std::cout << "\texperiment\t\tRun all methods on the instance"
                   << std::endl;
+        std::cout << "\tgenerate\t\tWrite a random instance to a file"
+                  << std::endl;
+        std::cout << "\tbench\t\tRun heuristics on growing random instances"
+                  << std::endl;
+        std::cout << "\tregress\t\tCompare heuristics against recorded results"
+                  << std::endl;
+        std::cout << "\tserve\t\tAnswer JSON solve requests from a warm cache"
+                  << std::endl;
+        std::cout << "\tlandscape\t\tCorrelate the cost of local optima with "
+                     "their similarity"
+                  << std::endl;
         return 0;
     }
 
@@ -261,6 +1250,26 @@ int main(int argc, char **argv) {
         return experiment_main(argc, argv);
     }
 
+    if (strcmp(argv[1], "generate") == 0) {
+        return generate_main(argc, argv);
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return bench_main(argc, argv);
+    }
+
+    if (strcmp(argv[1], "regress") == 0) {
+        return regress_main(argc, argv);
+    }
+
+    if (strcmp(argv[1], "serve") == 0) {
+        return serve_main(argc, argv);
+    }
+
+    if (strcmp(argv[1], "landscape") == 0) {
+        return landscape_main(argc, argv);
+    }
+
     std::cerr << ERROR << " unknown command: " << argv[1] << std::endl;
     return 1;
 }
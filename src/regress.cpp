@@ -0,0 +1,252 @@
+#pragma once
+
+#include "common/parse.cpp"
+#include "common/random.cpp"
+#include "common/stats.cpp"
+#include "solve.cpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define REGRESS_ALPHA 0.01
+#define REGRESS_TIME_THRESHOLD 0.10 // Relative slowdown of the median
+#define REGRESS_COST_THRESHOLD 0.01 // Relative increase of the median cost
+#define REGRESS_FUSED_PATHS 20      // Random paths the fused deltas run on
+
+struct samples_t {
+    std::vector<double> costs;
+    std::vector<double> runtimes;
+};
+
+// Cost and runtime columns of a results CSV, located by the header so
+// older files without the phase columns read the same
+std::optional<samples_t> read_samples(const std::string &path) {
+    std::ifstream in(path);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line)) {
+        return {};
+    }
+
+    int cost_col = -1, time_col = -1, col = 0;
+    std::stringstream header(line);
+    std::string name;
+    while (std::getline(header, name, ',')) {
+        if (name == "cost") {
+            cost_col = col;
+        } else if (name == "runtime_ms") {
+            time_col = col;
+        }
+        col++;
+    }
+    if (cost_col < 0 || time_col < 0) {
+        return {};
+    }
+
+    samples_t samples;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string value;
+        for (col = 0; std::getline(ss, value, ','); col++) {
+            if (col == cost_col) {
+                samples.costs.push_back(std::stod(value));
+            } else if (col == time_col) {
+                samples.runtimes.push_back(std::stod(value));
+            }
+        }
+    }
+
+    return samples;
+}
+
+// Cost and runtime of every run, all the rank test needs of them
+struct samples_sink_t : result_sink_t {
+    samples_t samples;
+
+    void push(unsigned int, const solution_t &solution) override {
+        samples.costs.push_back(solution.cost);
+        samples.runtimes.push_back(solution.runtime_ms);
+    }
+};
+
+// Compare the fused arrival costs (see: arrival_matrix_t) with the plain
+// formulas: every arrival_cost, and insertion_cost, remove_delta and
+// replace_delta at every position of a few random paths. Runs in any
+// build, unlike -DTSP_CHECK_FUSED. Returns the number of disagreements.
+unsigned int check_fused(const tsp_t &tsp, uint64_t seed) {
+    if (tsp.arrival.empty() || tsp.n < 3) {
+        return 0;
+    }
+
+    unsigned int errors = 0;
+    for (unsigned int i = 0; i < tsp.n; i++) {
+        for (unsigned int j = 0; j < tsp.n; j++) {
+            errors += tsp.arrival_cost(i, j) !=
+                      tsp.adj_matrix(i, j) + tsp.weights[j];
+        }
+    }
+
+    rng_t engine(seed);
+    base_cost_t base{&tsp};
+    std::vector<unsigned int> nodes(tsp.n);
+    std::iota(nodes.begin(), nodes.end(), 0);
+    for (unsigned int k = 0; k < REGRESS_FUSED_PATHS; k++) {
+        // A path of 2 to n - 1 nodes, the rest of `nodes` is outside it
+        std::shuffle(nodes.begin(), nodes.end(), engine);
+        unsigned int size = 2 + random_below(engine, tsp.n - 2);
+        solution_t sol(tsp, std::vector<unsigned int>(nodes.begin(),
+                                                      nodes.begin() + size));
+        for (unsigned int pos = 0; pos < size; pos++) {
+            unsigned int node =
+                nodes[size + random_below(engine, tsp.n - size)];
+            errors += sol.insert_delta(node, pos) !=
+                      sol.insert_delta(node, pos, base);
+            errors += sol.remove_delta(pos) != sol.remove_delta(pos, base);
+            errors += sol.replace_delta(node, pos) !=
+                      sol.replace_delta(node, pos, base);
+        }
+    }
+
+    return errors;
+}
+
+// Round-trip a random solution through write_solution_binary: one copy is
+// skipped as the journal skips the records of dropped instances, the next
+// is read back and must match, and the marker after it must be next in
+// line. Returns whether all of that held.
+bool check_solution_binary(const tsp_t &tsp, uint64_t seed) {
+    rng_t engine(seed);
+    std::vector<unsigned int> path(tsp.n);
+    std::iota(path.begin(), path.end(), 0);
+    std::shuffle(path.begin(), path.end(), engine);
+    path.resize(1 + random_below(engine, tsp.n));
+    solution_t written(tsp, path, 1.5, 7);
+    written.phase_ns.fill(3);
+
+    std::stringstream buffer;
+    write_solution_binary(buffer, written);
+    write_solution_binary(buffer, written);
+    write_binary<uint32_t>(buffer, BINARY_RESULTS_MAGIC);
+
+    if (!skip_solution_binary(buffer)) {
+        return false;
+    }
+    std::optional<solution_t> read = read_solution_binary(buffer, tsp);
+    uint32_t marker;
+    return read.has_value() && read->path == written.path &&
+           read->cost == written.cost &&
+           read->runtime_ms == written.runtime_ms &&
+           read->search_iters == written.search_iters &&
+           read->phase_ns == written.phase_ns &&
+           read_binary(buffer, marker) && marker == BINARY_RESULTS_MAGIC;
+}
+
+struct regress_options_t {
+    std::string baseline_dir = "./results/";
+    std::vector<heuristic_t> heuristics; // All with a baseline if empty
+    double alpha = REGRESS_ALPHA;
+    double time_threshold = REGRESS_TIME_THRESHOLD;
+    double cost_threshold = REGRESS_COST_THRESHOLD;
+    uint64_t seed = 0;
+};
+
+// A metric regressed if the new sample is significantly greater than the
+// baseline and its median grew by more than the threshold
+bool regressed(const std::vector<double> &current,
+               const std::vector<double> &baseline, double alpha,
+               double threshold, std::ostream &os) {
+    double old_median = median(baseline), new_median = median(current);
+    mann_whitney_t test = mann_whitney(current, baseline);
+    double change = old_median > 0 ? new_median / old_median - 1 : 0;
+
+    os << "," << old_median << "," << new_median << "," << change << ","
+       << test.p;
+    return test.p < alpha && change > threshold;
+}
+
+// Rerun the heuristics on the instance with a fixed seed and compare with
+// the baseline CSVs. Writes one CSV row per heuristic and returns the
+// number of regressions.
+unsigned int regress(const std::string &fname, const regress_options_t &opts,
+                     std::ostream &os) {
+    std::ifstream in(fname);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open file: " << fname << std::endl;
+        return 1;
+    }
+
+    std::optional<tsp_t> parsed;
+    try {
+        parsed.emplace(parse(in, fname));
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to read " << fname << ": " << e.what()
+                  << std::endl;
+        return 1;
+    }
+    const tsp_t &tsp = parsed.value();
+    std::string instance = instance_of(fname);
+
+    unsigned int regressions = 0;
+    if (unsigned int errors = check_fused(tsp, opts.seed); errors > 0) {
+        std::cerr << "Fused costs disagree with the unfused ones " << errors
+                  << " time(s) on " << instance << std::endl;
+        regressions++;
+    }
+    if (tsp.n > 0 && !check_solution_binary(tsp, opts.seed)) {
+        std::cerr << "Binary solutions do not round-trip on " << instance
+                  << std::endl;
+        regressions++;
+    }
+
+    std::vector<heuristic_t> heuristics = opts.heuristics;
+    if (heuristics.empty()) {
+        for (auto &[key, value] : heuristic_t_str) {
+            heuristics.push_back(key);
+        }
+    }
+
+    for (heuristic_t heuristic : heuristics) {
+        std::string path =
+            opts.baseline_dir + instance + "_" + heuristic_t_str[heuristic] +
+            ".csv";
+        std::optional<samples_t> baseline = read_samples(path);
+        if (!baseline.has_value()) {
+            if (!opts.heuristics.empty()) {
+                std::cerr << "No baseline at " << path << std::endl;
+                regressions++;
+            }
+            continue;
+        }
+
+        std::cerr << "Running " << heuristic_t_str[heuristic] << " on "
+                  << instance << std::endl;
+        seed_rng(opts.seed);
+        samples_sink_t sink;
+        solve(tsp, heuristic, sink);
+        const samples_t &current = sink.samples;
+
+        os << instance << "," << heuristic_t_str[heuristic];
+        bool cost = regressed(current.costs, baseline->costs, opts.alpha,
+                              opts.cost_threshold, os);
+        bool time = regressed(current.runtimes, baseline->runtimes,
+                              opts.alpha, opts.time_threshold, os);
+        os << "," << (cost || time ? "REGRESSED" : "ok") << std::endl;
+
+        regressions += cost || time;
+    }
+
+    return regressions;
+}
+
+void write_regress_header(std::ostream &os) {
+    os << "instance,heuristic,"
+       << "cost_median_old,cost_median_new,cost_change,cost_p,"
+       << "time_median_old,time_median_new,time_change,time_p,verdict"
+       << std::endl;
+}
@@ -0,0 +1,496 @@
+#pragma once
+
+#include "common/parse.cpp"
+#include "common/pool.cpp"
+#include "solve.cpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVE_CACHE_INSTANCES 8 // Parsed instances kept by default
+
+#pragma region JSON
+
+// Scalar member of a request; strings are unescaped, everything else is
+// kept as written
+struct json_value_t {
+    bool string;
+    std::string text;
+};
+
+typedef std::map<std::string, json_value_t> json_object_t;
+
+// Parse a flat JSON object of strings, numbers, booleans and nulls, the
+// only shape requests take
+std::optional<json_object_t> parse_json_object(const std::string &line) {
+    size_t i = 0;
+    auto skip_space = [&] {
+        while (i < line.size() && isspace((unsigned char)line[i])) {
+            i++;
+        }
+    };
+    auto parse_string = [&](std::string &out) {
+        if (line[i++] != '"') {
+            return false;
+        }
+        while (i < line.size() && line[i] != '"') {
+            char c = line[i++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (i >= line.size()) {
+                return false;
+            }
+
+            char escaped = line[i++];
+            switch (escaped) {
+            case 'n':
+                out += '\n';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u':
+                // Paths and names are ASCII, anything else is rejected
+                if (i + 4 > line.size()) {
+                    return false;
+                }
+                {
+                    long code = strtol(line.substr(i, 4).c_str(), nullptr, 16);
+                    if (code <= 0 || code > 0x7f) {
+                        return false;
+                    }
+                    out += char(code);
+                }
+                i += 4;
+                break;
+            default:
+                out += escaped;
+            }
+        }
+        return i++ < line.size();
+    };
+
+    json_object_t object;
+    skip_space();
+    if (i >= line.size() || line[i++] != '{') {
+        return {};
+    }
+    skip_space();
+    if (i < line.size() && line[i] == '}') {
+        i++;
+    } else {
+        while (true) {
+            std::string key;
+            json_value_t value = {false, ""};
+            skip_space();
+            if (i >= line.size() || !parse_string(key)) {
+                return {};
+            }
+            skip_space();
+            if (i >= line.size() || line[i++] != ':') {
+                return {};
+            }
+            skip_space();
+            if (i >= line.size()) {
+                return {};
+            }
+
+            if (line[i] == '"') {
+                value.string = true;
+                if (!parse_string(value.text)) {
+                    return {};
+                }
+            } else {
+                while (i < line.size() && line[i] != ',' && line[i] != '}' &&
+                       !isspace((unsigned char)line[i])) {
+                    value.text += line[i++];
+                }
+                if (value.text.empty()) {
+                    return {};
+                }
+            }
+            object[key] = value;
+
+            skip_space();
+            if (i >= line.size()) {
+                return {};
+            }
+            if (line[i] == '}') {
+                i++;
+                break;
+            }
+            if (line[i++] != ',') {
+                return {};
+            }
+        }
+    }
+
+    skip_space();
+    if (i != line.size()) {
+        return {};
+    }
+    return object;
+}
+
+void write_json_string(std::ostream &os, const std::string &text) {
+    os << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c == '\n') {
+            os << "\\n";
+        } else if ((unsigned char)c < 0x20) {
+            os << "\\u00" << "0123456789abcdef"[c >> 4]
+               << "0123456789abcdef"[c & 0xf];
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+#pragma endregion JSON
+
+#pragma region Cache
+
+// A parsed instance with its lazily built tables, shared by all requests
+// on it
+struct cached_instance_t {
+    std::filesystem::file_time_type mtime;
+    tsp_t tsp;
+    instance_t inst;
+    std::once_flag calibrated;
+    int calibration_ms;
+
+    cached_instance_t(std::filesystem::file_time_type mtime, tsp_t tsp)
+        : mtime(mtime), tsp(std::move(tsp)), inst(this->tsp), calibrated(),
+          calibration_ms(0) {}
+
+    // Time limit of the BUDGETED heuristics when a request sets none
+    int calibration() {
+        std::call_once(calibrated,
+                       [this] { calibration_ms = budget_ms(inst); });
+        return calibration_ms;
+    }
+};
+
+// Least recently used instances by path. An entry is reloaded when its file
+// changes; evicted entries live on until their last request is done.
+struct instance_cache_t {
+    typedef std::shared_ptr<cached_instance_t> entry_t;
+
+    unsigned int capacity;
+    std::mutex mutex;
+    std::list<std::pair<std::string, entry_t>> entries; // Most recent first
+    std::unordered_map<std::string, decltype(entries)::iterator> index;
+
+    instance_cache_t(unsigned int capacity)
+        : capacity(capacity), mutex(), entries(), index() {}
+
+    // Throws on files that are missing or do not parse
+    entry_t get(const std::string &path, bool &hit) {
+        std::error_code error;
+        auto mtime = std::filesystem::last_write_time(path, error);
+        if (error) {
+            throw std::runtime_error("failed to open file: " + path);
+        }
+        {
+            std::lock_guard lock(mutex);
+            auto found = index.find(path);
+            if (found != index.end() && found->second->second->mtime == mtime) {
+                entries.splice(entries.begin(), entries, found->second);
+                hit = true;
+                return found->second->second;
+            }
+        }
+
+        // Parse outside the lock, other requests go on meanwhile
+        hit = false;
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            throw std::runtime_error("failed to open file: " + path);
+        }
+        entry_t entry = std::make_shared<cached_instance_t>(mtime,
+                                                            parse(in, path));
+        if (entry->tsp.n < 3) {
+            throw std::runtime_error("instance too small: " + path);
+        }
+
+        std::lock_guard lock(mutex);
+        auto found = index.find(path);
+        if (found != index.end()) {
+            entries.erase(found->second);
+        }
+        entries.emplace_front(path, entry);
+        index[path] = entries.begin();
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        return entry;
+    }
+};
+
+#pragma endregion Cache
+
+// Where the responses of one client go. Responses of concurrent requests
+// are written whole, one line each, in completion order.
+struct client_t {
+    std::mutex mutex;
+    std::ostream *os = nullptr; // Stream client (stdin/stdout)
+    int fd = -1;                // Socket client
+
+    ~client_t() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    void send(const std::string &line) {
+        std::lock_guard lock(mutex);
+        if (os != nullptr) {
+            *os << line << std::flush;
+            return;
+        }
+
+        size_t sent = 0;
+        while (sent < line.size()) {
+            ssize_t n = ::send(fd, line.data() + sent, line.size() - sent,
+                               MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return; // Client gone, drop the response
+            }
+            sent += n;
+        }
+    }
+};
+
+// Solver daemon: keeps instances and their tables warm across requests and
+// solves them on a shared pool. Requests are JSON objects, one per line:
+//   {"id": 1, "instance": "data/TSPA.csv", "heuristic": "nn_any",
+//    "time_limit_ms": 500, "seed": 42, "rep": 0}
+// Only "instance" and "heuristic" are required; BUDGETED heuristics without
+// a time limit get the calibrated one. Every request is answered with one
+// line, {"id", "cost", "runtime_ms", "search_iters", "cached", "path"} or
+// {"id", "error"}, in completion order.
+struct server_t {
+    instance_cache_t cache;
+    work_pool_t pool;
+
+    server_t(unsigned int jobs, unsigned int capacity)
+        : cache(capacity), pool(jobs) {}
+
+    void submit(std::shared_ptr<client_t> client, std::string line) {
+        pool.submit([this, client, line = std::move(line)] {
+            client->send(handle(line));
+        });
+    }
+
+    // Serve requests from a stream until it ends
+    void serve_stream(std::istream &in, std::ostream &out) {
+        auto client = std::make_shared<client_t>();
+        client->os = &out;
+
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) {
+                submit(client, line);
+            }
+        }
+        pool.wait();
+    }
+
+    // Serve requests from every client of the socket, never returns unless
+    // the socket fails
+    bool serve_socket(const std::string &path) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Socket path too long: " << path << std::endl;
+            return false;
+        }
+        strcpy(addr.sun_path, path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+            std::cerr << "Failed to listen on " << path << ": "
+                      << strerror(errno) << std::endl;
+            return false;
+        }
+
+        std::cerr << "Listening on " << path << std::endl;
+        while (true) {
+            int conn = accept(fd, nullptr, nullptr);
+            if (conn < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                std::cerr << "accept failed: " << strerror(errno) << std::endl;
+                close(fd);
+                return false;
+            }
+
+            auto client = std::make_shared<client_t>();
+            client->fd = conn;
+            std::thread([this, client] { read_client(client); }).detach();
+        }
+    }
+
+  private:
+    void read_client(std::shared_ptr<client_t> client) {
+        std::string buffer;
+        char chunk[4096];
+        while (true) {
+            ssize_t n = recv(client->fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+
+            buffer.append(chunk, n);
+            size_t start = 0, end;
+            while ((end = buffer.find('\n', start)) != std::string::npos) {
+                if (end > start) {
+                    submit(client, buffer.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+            buffer.erase(0, start);
+        }
+        shutdown(client->fd, SHUT_RD);
+    }
+
+    std::string handle(const std::string &line) {
+        std::optional<json_object_t> request = parse_json_object(line);
+        std::ostringstream id;
+        if (!request.has_value() || !request->count("id")) {
+            id << "null";
+        } else if (request->at("id").string) {
+            write_json_string(id, request->at("id").text);
+        } else {
+            id << request->at("id").text;
+        }
+
+        std::ostringstream out;
+        out << "{\"id\": " << id.str();
+        try {
+            if (!request.has_value()) {
+                throw std::runtime_error("malformed request");
+            }
+            solve_request(request.value(), out);
+        } catch (const std::exception &e) {
+            out.str("");
+            out << "{\"id\": " << id.str() << ", \"error\": ";
+            write_json_string(out, e.what());
+        }
+
+        out << "}\n";
+        return out.str();
+    }
+
+    void solve_request(const json_object_t &request, std::ostream &out) {
+        auto field = [&](const char *key) -> const std::string * {
+            auto found = request.find(key);
+            return found == request.end() ? nullptr : &found->second.text;
+        };
+        auto number = [&](const char *key, unsigned long long fallback) {
+            const std::string *text = field(key);
+            if (text == nullptr) {
+                return fallback;
+            }
+            char *end;
+            errno = 0;
+            unsigned long long value = strtoull(text->c_str(), &end, 10);
+            if (errno != 0 || *end != '\0' || text->front() == '-') {
+                throw std::runtime_error(std::string("invalid ") + key);
+            }
+            return value;
+        };
+
+        const std::string *path = field("instance");
+        const std::string *name = field("heuristic");
+        if (path == nullptr || name == nullptr) {
+            throw std::runtime_error("instance and heuristic are required");
+        }
+
+        std::optional<heuristic_t> heuristic;
+        for (auto &[key, value] : heuristic_t_str) {
+            if (value == *name) {
+                heuristic = key;
+            }
+        }
+        if (!heuristic.has_value()) {
+            throw std::runtime_error("unknown heuristic: " + *name);
+        }
+
+        bool hit;
+        instance_cache_t::entry_t entry = cache.get(*path, hit);
+        unsigned long long time_limit_ms = number("time_limit_ms", 0);
+        if (heuristic_runs.at(heuristic.value()).kind == BUDGETED &&
+            time_limit_ms == 0) {
+            time_limit_ms = entry->calibration();
+        }
+
+        // PER_NODE heuristics start from node `rep`
+        unsigned long long rep = number("rep", 0);
+        if (rep >= repetitions(heuristic.value(), entry->inst.tsp)) {
+            throw std::runtime_error("rep out of range");
+        }
+
+        solution_t solution = run_heuristic(
+            entry->inst, heuristic.value(), rep,
+            std::min<unsigned long long>(time_limit_ms, INT_MAX),
+            number("seed", rng_base_seed.load()));
+
+        out << ", \"cost\": " << solution.cost
+            << ", \"runtime_ms\": " << solution.runtime_ms
+            << ", \"search_iters\": " << solution.search_iters
+            << ", \"cached\": " << (hit ? "true" : "false") << ", \"path\": [";
+        for (unsigned int i = 0; i < solution.path.size(); i++) {
+            out << (i ? ", " : "") << solution.path[i];
+        }
+        out << "]";
+    }
+};
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "calibration.cpp"
+#include "common/random.cpp"
+#include "common/sink.cpp"
+#include "common/tables.cpp"
 #include "common/types.cpp"
 #include "task1/solve_greedy_cycle.cpp"
 #include "task1/solve_nn.cpp"
@@ -12,9 +16,15 @@
 #include "task6/solve_local_multiple.cpp"
 #include "task7/solve_large_neighbors.cpp"
 #include "task9/solve_hybrid_evolutionary.cpp"
+#include "task10/solve_guided_local.cpp"
 
-#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
 enum heuristic_t {
@@ -36,6 +46,7 @@ enum heuristic_t {
     LOCAL_DELTAS_RANDOM_STEEPEST,
     LOCAL_SEARCH_MULTIPLE_START,
     LOCAL_SEARCH_ITERATED,
+    LOCAL_SEARCH_GUIDED,
     LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_LS,
     LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_NO_LS,
     HYBRID_EVOLUTIONARY_FILL,
@@ -63,6 +74,7 @@ std::map<heuristic_t, std::string> heuristic_t_str = {
     {LOCAL_DELTAS_RANDOM_STEEPEST, "local_deltas_random_steepest"},
     {LOCAL_SEARCH_MULTIPLE_START, "local_search_multiple_start"},
     {LOCAL_SEARCH_ITERATED, "local_search_iterated"},
+    {LOCAL_SEARCH_GUIDED, "local_search_guided"},
     {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_LS,
      "local_search_large_neighbourhood_ls"},
     {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_NO_LS,
@@ -71,63 +83,268 @@ std::map<heuristic_t, std::string> heuristic_t_str = {
     {HYBRID_EVOLUTIONARY_REPAIR_NO_LS, "hybrid_evolutionary_repair_no_ls"},
     {HYBRID_EVOLUTIONARY_REPAIR_LS, "hybrid_evolutionary_repair_ls"}};
 
-std::map<heuristic_t, solution_t (*)(const tsp_t &, unsigned int, unsigned int)>
-    gen_heuristics_to_fn = {
-        {NN_END, solve_nn_end},
-        {NN_ANY, solve_nn_any},
-        {GREEDY_CYCLE, solve_greedy_cycle},
-        {GREEDY_CYCLE_REGRET, solve_regret_unweighted},
-        {GREEDY_CYCLE_REGRET_WEIGHTED, solve_regret_weighted},
-        {LOCAL_SEARCH_GEN_GREEDY_SWAP, solve_local_search_gen_greedy_swap},
-        {LOCAL_SEARCH_GEN_GREEDY_REVERSE,
-         solve_local_search_gen_greedy_reverse},
-        {LOCAL_SEARCH_GEN_STEEPEST_SWAP, solve_local_search_gen_steepest_swap},
-        {LOCAL_SEARCH_GEN_STEEPEST_REVERSE,
-         solve_local_search_gen_steepest_reverse}};
-
-std::map<heuristic_t, std::vector<solution_t> (*)(const tsp_t &, unsigned int)>
-    random_heuristics_to_fn = {
-        {RANDOM, solve_random},
-        {LOCAL_SEARCH_RANDOM_GREEDY_SWAP,
-         solve_local_search_random_greedy_swap},
-        {LOCAL_SEARCH_RANDOM_GREEDY_REVERSE,
-         solve_local_search_random_greedy_reverse},
-        {LOCAL_SEARCH_RANDOM_STEEPEST_SWAP,
-         solve_local_search_random_steepest_swap},
-        {LOCAL_SEARCH_RANDOM_STEEPEST_REVERSE,
-         solve_local_search_random_steepest_reverse},
-        {LOCAL_CANDIDATES_RANDOM_STEEPEST,
-         solve_local_candidates_steepest_random},
-        {LOCAL_DELTAS_RANDOM_STEEPEST, solve_local_deltas_steepest_random},
-        {LOCAL_SEARCH_MULTIPLE_START, solve_local_search_multiple_start},
-        {LOCAL_SEARCH_ITERATED, solve_local_search_iterated},
-        {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_LS,
-         solve_large_neighborhood_search_ls},
-        {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_NO_LS,
-         solve_large_neighborhood_search_nols},
-        {HYBRID_EVOLUTIONARY_FILL, solve_hybrid_evolutionary_fill},
-        {HYBRID_EVOLUTIONARY_REPAIR_NO_LS,
-         solve_hybrid_evolutionary_repair_no_ls},
-        {HYBRID_EVOLUTIONARY_REPAIR_LS, solve_hybrid_evolutionary_repair_ls}};
-
-std::vector<solution_t> solve(const tsp_t &tsp, heuristic_t heuristic) {
-    std::vector<solution_t> solutions;
-    unsigned int n = ceil(tsp.n / 2.0);
-
-    if (random_heuristics_to_fn.find(heuristic) !=
-        random_heuristics_to_fn.end()) {
-        return random_heuristics_to_fn[heuristic](tsp, n);
+#define REPETITIONS 20 // Default runs of the non-constructive heuristics
+
+// Runs of the non-constructive heuristics (see: --repetitions)
+unsigned int run_repetitions = REPETITIONS;
+
+// Share of the path the LNS destroy step removes (see: --destroy-fraction)
+double lns_destroy_fraction = DESTROY_FRACTION;
+
+// Time limit of the BUDGETED heuristics set by --time-limit, 0 to calibrate
+// it per instance
+int fixed_time_limit_ms = 0;
+
+// Where calibrations are kept across invocations (see: --calibration), may
+// be null
+calibration_cache_t *calibration_cache = nullptr;
+
+// Shared data of an instance. The tables are built on first use and then
+// only read, so every run of every heuristic (on any thread) shares them.
+struct instance_t {
+    const tsp_t &tsp;
+    std::string name; // For the calibration cache, may be empty
+    unsigned int path_size;
+
+    instance_t(const tsp_t &tsp, const std::string &name = "")
+        : tsp(tsp), name(name), path_size(ceil(tsp.n / 2.0)), tables_once(),
+          tables_ptr(), neighbors_mutex(), neighbors_by_k() {}
+
+    const tables_t &tables() {
+        std::call_once(tables_once, [this] {
+            tables_ptr = std::make_unique<const tables_t>(tsp);
+        });
+        return *tables_ptr;
+    }
+
+    // Nearest neighbours lists of size k (see: get_nearest_neighbors)
+    const neighbors_t &neighbors(unsigned int k) {
+        std::lock_guard lock(neighbors_mutex);
+        auto it = neighbors_by_k.find(k);
+        if (it == neighbors_by_k.end()) {
+            it = neighbors_by_k.emplace(k, get_nearest_neighbors(tsp, k)).first;
+        }
+        return it->second;
     }
 
-    const auto fn = gen_heuristics_to_fn[heuristic];
+  private:
+    std::once_flag tables_once;
+    std::unique_ptr<const tables_t> tables_ptr;
+    std::mutex neighbors_mutex;
+    std::map<unsigned int, neighbors_t> neighbors_by_k;
+};
+
+// PER_NODE heuristics run once per node (the start node of the
+// constructive ones), the others run_repetitions times. BUDGETED ones get
+// the mean MSLS runtime as their time limit (see: budget_ms).
+enum run_kind_t { PER_NODE, REPEATED, BUDGETED };
+
+// Single run of a heuristic, rep is the index of the run
+typedef solution_t (*run_fn_t)(instance_t &, unsigned int rep,
+                               int time_limit_ms);
+
+struct run_spec_t {
+    run_kind_t kind;
+    run_fn_t fn;
+};
+
+template <solution_t (*fn)(const tsp_t &, const tables_t &, unsigned int,
+                           unsigned int)>
+solution_t constructive_run(instance_t &inst, unsigned int rep, int) {
+    // Local search inside the generator takes its own phase
+    scoped_phase_t phase(CONSTRUCT);
+    return fn(inst.tsp, inst.tables(), inst.path_size, rep);
+}
+
+solution_t random_run(instance_t &inst, unsigned int, int) {
+    return gen_random_solution(inst.tsp, inst.path_size);
+}
+
+template <solution_t::op_type_t op_type, search_t search_type>
+solution_t random_ls_run(instance_t &inst, unsigned int, int) {
+    return solve_local_search(gen_random_solution(inst.tsp, inst.path_size),
+                              op_type, search_type);
+}
+
+solution_t candidates_run(instance_t &inst, unsigned int, int) {
+    return local_candidates_steepest(
+        inst.tsp, gen_random_solution(inst.tsp, inst.path_size),
+        inst.neighbors(10));
+}
+
+solution_t deltas_run(instance_t &inst, unsigned int, int) {
+    return local_deltas_steepest(
+        inst.tsp, gen_random_solution(inst.tsp, inst.path_size));
+}
+
+solution_t multiple_start_run(instance_t &inst, unsigned int, int) {
+    solution_t solution =
+        local_search_multiple_start(inst.tsp, inst.path_size);
+    solution.search_iters = inst.tsp.n;
+    return solution;
+}
+
+solution_t iterated_run(instance_t &inst, unsigned int, int time_limit_ms) {
+    return local_search_iterated(inst.tsp, inst.path_size, time_limit_ms);
+}
+
+solution_t guided_run(instance_t &inst, unsigned int, int time_limit_ms) {
+    return guided_local_search(inst.tsp, inst.path_size, time_limit_ms,
+                               inst.neighbors(GLS_CANDIDATES));
+}
+
+template <bool ls>
+solution_t large_neighborhood_run(instance_t &inst, unsigned int,
+                                  int time_limit_ms) {
+    return large_neighborhood_search(inst.tsp, inst.path_size, time_limit_ms,
+                                     ls, lns_destroy_fraction);
+}
+
+template <solution_t (*recomb_oper)(const solution_t &, const solution_t &),
+          bool ls>
+solution_t hybrid_evolutionary_run(instance_t &inst, unsigned int,
+                                   int time_limit_ms) {
+    return solve_hybrid_evolutionary(inst.tsp, inst.path_size, 20,
+                                     recomb_oper, ls, time_limit_ms);
+}
+
+std::map<heuristic_t, run_spec_t> heuristic_runs = {
+    {RANDOM, {PER_NODE, random_run}},
+    {NN_END, {PER_NODE, constructive_run<solve_nn_end>}},
+    {NN_ANY, {PER_NODE, constructive_run<solve_nn_any>}},
+    {GREEDY_CYCLE, {PER_NODE, constructive_run<solve_greedy_cycle>}},
+    {GREEDY_CYCLE_REGRET,
+     {PER_NODE, constructive_run<solve_regret_unweighted>}},
+    {GREEDY_CYCLE_REGRET_WEIGHTED,
+     {PER_NODE, constructive_run<solve_regret_weighted>}},
+    {LOCAL_SEARCH_GEN_GREEDY_SWAP,
+     {PER_NODE, constructive_run<solve_local_search_gen_greedy_swap>}},
+    {LOCAL_SEARCH_GEN_GREEDY_REVERSE,
+     {PER_NODE, constructive_run<solve_local_search_gen_greedy_reverse>}},
+    {LOCAL_SEARCH_GEN_STEEPEST_SWAP,
+     {PER_NODE, constructive_run<solve_local_search_gen_steepest_swap>}},
+    {LOCAL_SEARCH_GEN_STEEPEST_REVERSE,
+     {PER_NODE, constructive_run<solve_local_search_gen_steepest_reverse>}},
+    {LOCAL_SEARCH_RANDOM_GREEDY_SWAP,
+     {PER_NODE, random_ls_run<solution_t::SWAP, GREEDY>}},
+    {LOCAL_SEARCH_RANDOM_GREEDY_REVERSE,
+     {PER_NODE, random_ls_run<solution_t::REVERSE, GREEDY>}},
+    {LOCAL_SEARCH_RANDOM_STEEPEST_SWAP,
+     {PER_NODE, random_ls_run<solution_t::SWAP, STEEPEST>}},
+    {LOCAL_SEARCH_RANDOM_STEEPEST_REVERSE,
+     {PER_NODE, random_ls_run<solution_t::REVERSE, STEEPEST>}},
+    {LOCAL_CANDIDATES_RANDOM_STEEPEST, {PER_NODE, candidates_run}},
+    {LOCAL_DELTAS_RANDOM_STEEPEST, {PER_NODE, deltas_run}},
+    {LOCAL_SEARCH_MULTIPLE_START, {REPEATED, multiple_start_run}},
+    {LOCAL_SEARCH_ITERATED, {BUDGETED, iterated_run}},
+    {LOCAL_SEARCH_GUIDED, {BUDGETED, guided_run}},
+    {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_LS,
+     {BUDGETED, large_neighborhood_run<true>}},
+    {LOCAL_SEARCH_LARGE_NEIGHBOURHOOD_NO_LS,
+     {BUDGETED, large_neighborhood_run<false>}},
+    {HYBRID_EVOLUTIONARY_FILL,
+     {BUDGETED, hybrid_evolutionary_run<random_fill_op, false>}},
+    {HYBRID_EVOLUTIONARY_REPAIR_NO_LS,
+     {BUDGETED, hybrid_evolutionary_run<heuristic_repair_op, false>}},
+    {HYBRID_EVOLUTIONARY_REPAIR_LS,
+     {BUDGETED, hybrid_evolutionary_run<heuristic_repair_op, true>}}};
+
+// The heuristic whose runs calibrate the time limit of the BUDGETED ones
+#define CALIBRATION_HEURISTIC LOCAL_SEARCH_MULTIPLE_START
+
+unsigned int repetitions(heuristic_t heuristic, const tsp_t &tsp) {
+    return heuristic_runs.at(heuristic).kind == PER_NODE ? tsp.n
+                                                         : run_repetitions;
+}
+
+// Time limit of the BUDGETED heuristics, the mean runtime of the
+// calibration runs
+int calibration_ms(const running_stats_t &runtimes) {
+    return runtimes.mean;
+}
+
+// Timed and profiled run number `rep` of the heuristic. Every run draws
+// from its own stream, so results are reproducible for a given --seed no
+// matter which thread runs them or in what order.
+solution_t run_heuristic(instance_t &inst, heuristic_t heuristic,
+                         unsigned int rep, int time_limit_ms = 0,
+                         uint64_t seed = rng_base_seed.load()) {
+    rng_stream((uint64_t(heuristic) << 32) | rep, seed);
+    const run_spec_t &spec = heuristic_runs.at(heuristic);
     timer_t timer;
 
-    for (unsigned int i = 0; i < tsp.n; i++) {
-        timer.start();
-        solution_t solution = fn(tsp, n, i);
-        solution.runtime_ms = timer.measure();
-        solutions.push_back(solution);
+    start_run(timer);
+    solution_t solution = spec.fn(inst, rep, time_limit_ms);
+    finish_run(solution, timer);
+    return solution;
+}
+
+int budget_ms(instance_t &inst);
+
+// Run all repetitions of the heuristic one after another, handing every
+// solution to fn(rep, solution) as soon as it is done
+template <typename fn_t>
+void for_each_run(instance_t &inst, heuristic_t heuristic, fn_t &&fn) {
+    scoped_trace_t trace(heuristic_t_str.at(heuristic).c_str());
+
+    int time_limit_ms = 0;
+    if (heuristic_runs.at(heuristic).kind == BUDGETED) {
+        time_limit_ms = budget_ms(inst);
     }
 
-    return solutions;
+    unsigned int reps = repetitions(heuristic, inst.tsp);
+    for (unsigned int rep = 0; rep < reps; rep++) {
+        fn(rep, run_heuristic(inst, heuristic, rep, time_limit_ms));
+    }
+}
+
+// Time limit of the BUDGETED heuristics on this instance, measured by
+// running the calibration heuristic
+int calibrate(instance_t &inst) {
+    running_stats_t runtimes;
+    for_each_run(inst, CALIBRATION_HEURISTIC,
+                 [&](unsigned int, solution_t &&solution) {
+                     runtimes.push(solution.runtime_ms);
+                 });
+    return calibration_ms(runtimes);
+}
+
+// The time limit known without calibrating: the fixed one or a cached one
+std::optional<int> known_budget_ms(const tsp_t &tsp) {
+    if (fixed_time_limit_ms > 0) {
+        return fixed_time_limit_ms;
+    }
+    if (calibration_cache != nullptr) {
+        return calibration_cache->find(instance_hash(tsp));
+    }
+    return {};
+}
+
+void remember_budget_ms(const instance_t &inst, int time_limit_ms) {
+    if (calibration_cache != nullptr) {
+        calibration_cache->store(instance_hash(inst.tsp), inst.name,
+                                 inst.tsp.n, time_limit_ms);
+    }
+}
+
+// Time limit of the BUDGETED heuristics on this instance, calibrated only
+// when it is neither fixed nor cached
+int budget_ms(instance_t &inst) {
+    std::optional<int> known = known_budget_ms(inst.tsp);
+    if (known.has_value()) {
+        return known.value();
+    }
+
+    int time_limit_ms = calibrate(inst);
+    remember_budget_ms(inst, time_limit_ms);
+    return time_limit_ms;
+}
+
+void solve(const tsp_t &tsp, heuristic_t heuristic, result_sink_t &sink,
+           const std::string &name = "") {
+    instance_t inst(tsp, name);
+    for_each_run(inst, heuristic, [&](unsigned int rep, solution_t &&solution) {
+        sink.push(rep, solution);
+    });
+    sink.finish();
 }
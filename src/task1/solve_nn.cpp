@@ -1,56 +1,40 @@
-#include "../common/search.cpp"
+#include "../common/insertion.cpp"
+#include "../common/tables.cpp"
 #include "../common/types.cpp"
 
-solution_t solve_nn_end(const tsp_t &tsp, unsigned int n, unsigned int start) {
-    solution_t solution(tsp, start);
-
-    while (solution.path.size() < n) {
-        auto [min, min_delta] = find_nn(solution, [=](unsigned int node) {
-            return solution.append_delta(node);
-        });
+#include <climits>
+#include <vector>
+
+solution_t solve_nn_end(const tsp_t &tsp, const tables_t &tables,
+                        unsigned int n, unsigned int start) {
+    std::vector<unsigned int> path = {start};
+    std::vector<bool> used(tsp.n, false);
+    used[start] = true;
+
+    // Nodes are sorted by append cost from every end node, so the nearest
+    // neighbour is the first one not used yet
+    while (path.size() < n) {
+        const unsigned int *neighbors = tables.neighbors(path.back());
+        while (used[*neighbors]) {
+            neighbors++;
+        }
 
-        solution.append(min);
+        path.push_back(*neighbors);
+        used[*neighbors] = true;
     }
 
-    solution.cost +=
-        tsp.adj_matrix(solution.path.back(), solution.path.front());
-    return solution;
+    return solution_t(tsp, path);
 }
 
-solution_t solve_nn_any(const tsp_t &tsp, unsigned int n, unsigned int start) {
-    solution_t solution(tsp, start);
-
-    while (solution.path.size() < n) {
-        unsigned int min_pos = -1;
-
-        auto [min, min_delta] = find_nn(solution, [=](unsigned int node) {
-            return solution.prepend_delta(node);
-        });
-
-        for (int i = 0; i < solution.path.size() - 1; i++) {
-            auto [min_replace, min_replace_delta] = find_replace(solution, i);
-
-            if (min_replace_delta < min_delta) {
-                min = min_replace;
-                min_delta = min_replace_delta;
-                min_pos = i;
-            }
+solution_t solve_nn_any(const tsp_t &tsp, const tables_t &,
+                        unsigned int n, unsigned int start) {
+    // Grow the path at either end or in between, closing it at the end
+    auto cost = [&tsp](unsigned int a, unsigned int node, unsigned int b) {
+        if (a != UINT_MAX && b != UINT_MAX) {
+            return tsp.insertion_cost(a, node, b);
         }
+        return tsp.arrival_cost(a != UINT_MAX ? a : b, node);
+    };
 
-        auto [last, last_delta] = find_nn(solution, [=](unsigned int node) {
-            return solution.append_delta(node);
-        });
-
-        if (last_delta < min_delta) {
-            solution.append(last);
-        } else if (min_pos == -1) {
-            solution.prepend(min);
-        } else {
-            solution.insert(min, min_pos);
-        }
-    }
-
-    solution.cost +=
-        tsp.adj_matrix(solution.path.back(), solution.path.front());
-    return solution;
+    return solution_t(tsp, cheapest_insertion(tsp, {start}, n, cost, true));
 }
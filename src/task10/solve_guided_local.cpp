@@ -0,0 +1,228 @@
+#pragma once
+
+#include "../common/checkpoint.cpp"
+#include "../common/convergence.cpp"
+#include "../common/types.cpp"
+#include "../task1/solve_random.cpp"
+#include "../task4/solve_local_candidates.cpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define GLS_ALPHA 0.1
+#define GLS_CANDIDATES 20
+
+// Penalties of the solution features: entry (a, b) penalizes edge a-b and
+// the diagonal entry (v, v) penalizes selecting node v
+struct penalties_t {
+    unsigned int n;
+    std::vector<uint16_t> m;
+
+    penalties_t(unsigned int n) : n(n), m(size_t(n) * n, 0) {}
+
+    size_t index(unsigned int a, unsigned int b) const {
+        return size_t(a) * n + b;
+    }
+
+    uint16_t operator()(unsigned int a, unsigned int b) const {
+        return m[index(a, b)];
+    }
+
+    void penalize(unsigned int a, unsigned int b) {
+        if (m[index(a, b)] < UINT16_MAX) {
+            m[index(a, b)]++;
+            m[index(b, a)] = m[index(a, b)];
+        }
+    }
+};
+
+// Augmented objective of GLS, the plain cost plus lambda times the penalties
+struct guided_cost_t {
+    const tsp_t *tsp;
+    const penalties_t *penalties;
+    int lambda;
+
+    int edge(unsigned int a, unsigned int b) const {
+        return tsp->adj_matrix(a, b) + lambda * (*penalties)(a, b);
+    }
+    int node(unsigned int v) const {
+        return tsp->weights[v] + lambda * (*penalties)(v, v);
+    }
+};
+
+// First-improvement candidate search with don't-look bits. Only nodes in
+// `active` are examined; a node drops out once none of its candidate moves
+// improves, and comes back when a move or a penalty touches it.
+struct dlb_search_t {
+    const neighbors_t *neighbors;
+    std::vector<int> pos; // Position of every node in the path, -1 if absent
+    std::deque<unsigned int> active;
+    std::vector<bool> is_active;
+
+    dlb_search_t(const solution_t &sol, const neighbors_t &neighbors)
+        : neighbors(&neighbors), pos(sol.tsp->n, -1), active(),
+          is_active(sol.tsp->n, false) {
+        for (unsigned int i = 0; i < sol.path.size(); i++) {
+            pos[sol.path[i]] = i;
+            activate(sol.path[i]);
+        }
+    }
+
+    void activate(unsigned int node) {
+        if (!is_active[node]) {
+            STAT(DLB_ACTIVATIONS);
+            is_active[node] = true;
+            active.push_back(node);
+        }
+    }
+
+    void reverse(solution_t &sol, unsigned int pos1, unsigned int pos2) {
+        for (unsigned int p : {sol.prev(pos1), pos1, pos2, sol.next(pos2)}) {
+            activate(sol.path[p]);
+        }
+
+        sol.reverse(pos1, pos2);
+        for (unsigned int p = pos1; p <= pos2; p++) {
+            pos[sol.path[p]] = p;
+        }
+    }
+
+    void replace(solution_t &sol, unsigned int node, unsigned int at) {
+        unsigned int old_node = sol.path[at];
+        activate(sol.path[sol.prev(at)]);
+        activate(sol.path[sol.next(at)]);
+        activate(node);
+
+        sol.replace(node, at);
+        pos[old_node] = -1;
+        pos[node] = at;
+    }
+
+    // Try the candidate moves introducing an edge between node and one of
+    // its nearest neighbours, applying the first improving one
+    template <typename cost_t>
+    bool improve(solution_t &sol, unsigned int node, const cost_t &cost) {
+        unsigned int idx = pos[node];
+
+        for (unsigned int neighb : neighbors->at(node)) {
+            if (pos[neighb] < 0) {
+                for (unsigned int at : {sol.prev(idx), sol.next(idx)}) {
+                    if (sol.replace_delta(neighb, at, cost) < 0) {
+                        replace(sol, neighb, at);
+                        return true;
+                    }
+                }
+                continue;
+            }
+
+            unsigned int neighb_idx = pos[neighb];
+            if (neighb_idx == sol.next(idx) || idx == sol.next(neighb_idx)) {
+                continue;
+            }
+
+            unsigned int smaller = std::min(idx, neighb_idx);
+            unsigned int bigger = std::max(idx, neighb_idx);
+
+            if (sol.reverse_delta(sol.next(smaller), bigger, cost) < 0) {
+                reverse(sol, sol.next(smaller), bigger);
+                return true;
+            }
+            if (sol.reverse_delta(smaller, sol.prev(bigger), cost) < 0) {
+                reverse(sol, smaller, sol.prev(bigger));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    template <typename cost_t> void run(solution_t &sol, const cost_t &cost) {
+        scoped_phase_t phase(LOCAL_SEARCH);
+        while (!active.empty()) {
+            unsigned int node = active.front();
+            active.pop_front();
+            is_active[node] = false;
+
+            if (pos[node] >= 0 && improve(sol, node, cost)) {
+                activate(node);
+            }
+        }
+    }
+};
+
+// Penalize the features of the local optimum with maximal utility
+// cost / (1 + penalty) and wake up the nodes around them
+void penalize_features(const solution_t &sol, penalties_t &penalties,
+                       dlb_search_t &search) {
+    scoped_phase_t phase(PERTURB);
+    const tsp_t &tsp = *sol.tsp;
+    double max_util = 0;
+
+    auto edge_util = [&](unsigned int i) {
+        unsigned int a = sol.path[i], b = sol.path[sol.next(i)];
+        return tsp.adj_matrix(a, b) / (1.0 + penalties(a, b));
+    };
+    auto node_util = [&](unsigned int i) {
+        unsigned int v = sol.path[i];
+        return tsp.weights[v] / (1.0 + penalties(v, v));
+    };
+
+    for (unsigned int i = 0; i < sol.path.size(); i++) {
+        max_util = std::max({max_util, edge_util(i), node_util(i)});
+    }
+
+    for (unsigned int i = 0; i < sol.path.size(); i++) {
+        unsigned int a = sol.path[i], b = sol.path[sol.next(i)];
+
+        if (edge_util(i) == max_util) {
+            penalties.penalize(a, b);
+            search.activate(a);
+            search.activate(b);
+        }
+        if (node_util(i) == max_util) {
+            penalties.penalize(a, a);
+            search.activate(sol.path[sol.prev(i)]);
+            search.activate(b);
+        }
+    }
+}
+
+solution_t guided_local_search(const tsp_t &tsp, unsigned int path_size,
+                               int time_limit_ms,
+                               const neighbors_t &neighbors) {
+    solution_t solution =
+        warm_start_or([&] { return gen_random_solution(tsp, path_size); });
+    penalties_t penalties(tsp.n);
+    guided_cost_t cost{&tsp, &penalties, 0};
+    dlb_search_t search(solution, neighbors);
+    convergence_t trace;
+    timer_t timer;
+
+    timer.start();
+    search.run(solution, base_cost_t{&tsp});
+    trace.record(0, solution.cost);
+    solution_t best = solution;
+    cost.lambda = std::max(1, int(GLS_ALPHA * solution.cost / path_size));
+
+    int i = 1;
+    while (timer.measure() < time_limit_ms) {
+        penalize_features(solution, penalties, search);
+        search.run(solution, cost);
+        trace.record(i, solution.cost);
+
+        if (solution.cost < best.cost) {
+            best = solution;
+        }
+        checkpoint_best(best);
+
+        i++;
+    }
+
+    best.search_iters = i;
+    finish_trace(trace);
+    return best;
+}
@@ -1,65 +1,212 @@
 #pragma once
 
-#include "../common/search.cpp"
+#include "../common/tables.cpp"
 #include "../common/types.cpp"
 
 #include <algorithm>
 #include <climits>
-#include <numeric>
+#include <thread>
+#include <vector>
 
 #define REGRET_K 2
 #define REGRET_WEIGHT 0.5
+#define REGRET_PARALLEL_MIN 512 // Fewest stale nodes worth a parallel rescan
 
-solution_t solve_regret(solution_t solution, unsigned int n, float weight) {
-    std::vector<pos_delta_t> deltas;
-    deltas.reserve(n);
+// Insertion of a node between `after` and its successor on the cycle
+struct regret_entry_t {
+    int delta;
+    unsigned int after;
+};
 
-    while (solution.path.size() < n) {
-        std::optional<unsigned int> max;
-        int max_score = INT_MIN;
-        int idx = 0;
+// Incremental k-regret insertion. Every remaining node caches its k
+// cheapest insertion slots; inserting a node only replaces one edge with
+// two, so the caches are patched with the two new edges and only the
+// nodes whose cached slots used the removed edge are rescanned in full.
+struct regret_engine_t {
+    const tsp_t *tsp;
+    unsigned int k;
+    unsigned int threads;
+    std::vector<unsigned int> succ;      // successor on the cycle
+    std::vector<unsigned int> cycle;     // nodes on the cycle
+    std::vector<unsigned int> remaining; // nodes not on the cycle
+    std::vector<regret_entry_t> top;     // k best slots per node, flat
+    std::vector<unsigned int> top_size;
+    std::vector<unsigned int> stale;
+
+    regret_engine_t(const solution_t &solution, unsigned int k,
+                    unsigned int threads = 1)
+        : tsp(solution.tsp), k(std::max(k, 1u)), threads(threads),
+          succ(tsp->n, UINT_MAX), cycle(solution.path),
+          remaining(solution.remaining_nodes.begin(),
+                    solution.remaining_nodes.end()),
+          top(tsp->n * this->k), top_size(tsp->n, 0), stale() {
+        for (unsigned int i = 0; i < solution.path.size(); i++) {
+            succ[solution.path[i]] = solution.path[solution.next(i)];
+        }
+
+        rescan(remaining);
+    }
+
+    int insert_delta(unsigned int node, unsigned int after) const {
+        return tsp->insertion_cost(after, node, succ[after]);
+    }
+
+    // Keep the slot if it is among the k best of the node
+    void offer(unsigned int node, regret_entry_t entry) {
+        regret_entry_t *best = &top[node * k];
+        unsigned int &size = top_size[node];
+
+        if (size == k && entry.delta >= best[k - 1].delta) {
+            return;
+        }
+
+        unsigned int i = size < k ? size++ : k - 1;
+        for (; i > 0 && best[i - 1].delta > entry.delta; i--) {
+            best[i] = best[i - 1];
+        }
+        best[i] = entry;
+    }
+
+    void rescan(unsigned int node) {
+        top_size[node] = 0;
+        for (unsigned int after : cycle) {
+            offer(node, {insert_delta(node, after), after});
+        }
+    }
+
+    void rescan(const std::vector<unsigned int> &nodes) {
+        if (threads <= 1 || nodes.size() < REGRET_PARALLEL_MIN) {
+            for (unsigned int node : nodes) {
+                rescan(node);
+            }
+            return;
+        }
+
+        // Nodes own disjoint cache rows, so chunks need no synchronisation
+        std::vector<std::thread> workers;
+        unsigned int chunk = (nodes.size() + threads - 1) / threads;
+        for (unsigned int t = 0; t < threads; t++) {
+            unsigned int from = t * chunk;
+            unsigned int to =
+                std::min<unsigned int>(from + chunk, nodes.size());
+            if (from >= to) {
+                break;
+            }
+
+            workers.emplace_back([this, &nodes, from, to]() {
+                for (unsigned int i = from; i < to; i++) {
+                    rescan(nodes[i]);
+                }
+            });
+        }
+
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
 
-        for (auto node : solution.remaining_nodes) {
-            deltas.clear();
+    int score(unsigned int node, float weight) const {
+        const regret_entry_t *best = &top[node * k];
+        int regret = 0;
+        for (unsigned int i = 1; i < top_size[node]; i++) {
+            regret += best[i].delta - best[0].delta;
+        }
+        return weight * regret - (1 - weight) * best[0].delta;
+    }
 
-            for (int i = 0; i < solution.path.size(); i++) {
-                deltas.push_back({i, solution.insert_delta(node, i)});
+    // Index into `remaining` of the node with the highest regret score
+    unsigned int select(float weight) const {
+        unsigned int idx = 0;
+        int max_score = INT_MIN;
+
+        for (unsigned int i = 0; i < remaining.size(); i++) {
+            int node_score = score(remaining[i], weight);
+            if (node_score > max_score) {
+                max_score = node_score;
+                idx = i;
             }
+        }
+
+        return idx;
+    }
 
-            std::sort(deltas.begin(), deltas.end(),
-                      [](const pos_delta_t &pair1, const pos_delta_t &pair2) {
-                          return pair1.second < pair2.second;
-                      });
+    // Insert the remaining node at `idx` into its cheapest slot, returning
+    // the cost delta
+    int insert(unsigned int idx) {
+        unsigned int node = remaining[idx];
+        regret_entry_t entry = top[node * k];
+        unsigned int a = entry.after;
+        unsigned int b = succ[a];
 
-            int regret = std::accumulate(
-                deltas.begin(), deltas.begin() + REGRET_K, 0,
-                [&](int regret, pos_delta_t pair) {
-                    return regret + pair.second - deltas[0].second;
-                });
+        remaining[idx] = remaining.back();
+        remaining.pop_back();
+        succ[a] = node;
+        succ[node] = b;
+        cycle.push_back(node);
 
-            int score = weight * regret - (1 - weight) * deltas[0].second;
+        stale.clear();
+        for (unsigned int other : remaining) {
+            const regret_entry_t *best = &top[other * k];
+            bool uses_edge = false;
+            for (unsigned int i = 0; i < top_size[other]; i++) {
+                uses_edge |= best[i].after == a;
+            }
 
-            if (score > max_score) {
-                max_score = score;
-                max = node;
-                idx = deltas[0].first;
+            if (uses_edge) {
+                stale.push_back(other);
+                continue;
             }
+
+            offer(other, {insert_delta(other, a), a});
+            offer(other, {insert_delta(other, node), node});
         }
+        rescan(stale);
+
+        return entry.delta;
+    }
+
+    std::vector<unsigned int> path(unsigned int start) const {
+        std::vector<unsigned int> result;
+        result.reserve(cycle.size());
+
+        unsigned int node = start;
+        do {
+            result.push_back(node);
+            node = succ[node];
+        } while (node != start);
+
+        return result;
+    }
+};
+
+solution_t solve_regret(solution_t solution, unsigned int n, float weight,
+                        unsigned int k = REGRET_K, unsigned int threads = 1) {
+    if (solution.path.size() >= n || solution.path.empty()) {
+        return solution;
+    }
+
+    regret_engine_t engine(solution, k, threads);
 
-        solution.insert(max.value(), idx);
+    for (unsigned int size = solution.path.size();
+         size < n && !engine.remaining.empty(); size++) {
+        unsigned int idx = engine.select(weight);
+        unsigned int node = engine.remaining[idx];
+        solution.cost += engine.insert(idx);
+        solution.remaining_nodes.erase(node);
     }
 
+    solution.path = engine.path(solution.path.front());
     return solution;
 }
 
-solution_t solve_regret_weighted(const tsp_t &tsp, unsigned int n,
-                                 unsigned int start) {
-    solution_t solution(tsp, find_cycle(tsp, start));
+solution_t solve_regret_weighted(const tsp_t &tsp, const tables_t &tables,
+                                 unsigned int n, unsigned int start) {
+    solution_t solution(tsp, tables.cycle(start));
     return solve_regret(solution, n, REGRET_WEIGHT);
 }
 
-solution_t solve_regret_unweighted(const tsp_t &tsp, unsigned int n,
-                                   unsigned int start) {
-    solution_t solution(tsp, find_cycle(tsp, start));
+solution_t solve_regret_unweighted(const tsp_t &tsp, const tables_t &tables,
+                                   unsigned int n, unsigned int start) {
+    solution_t solution(tsp, tables.cycle(start));
     return solve_regret(solution, n, 1.0);
 }
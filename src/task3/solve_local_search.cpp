@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../common/random.cpp"
 #include "../common/types.cpp"
 #include "../task1/solve_random.cpp"
 #include "../task2/solve_greedy_regret.cpp"
@@ -7,11 +8,8 @@
 #include <algorithm>
 #include <chrono>
 #include <optional>
-#include <random>
 #include <vector>
 
-std::mt19937 g = std::mt19937(std::random_device()());
-
 enum search_t { GREEDY, STEEPEST };
 
 std::optional<operation_t>
@@ -31,7 +29,7 @@ greedy_search(const solution_t &solution,
         }
     }
 
-    std::shuffle(indices.begin(), indices.end(), g);
+    std::shuffle(indices.begin(), indices.end(), rng());
 
     for (int idx : indices) {
         operation_t op = neighbourhood[idx];
@@ -90,6 +88,7 @@ std::optional<operation_t> steepest_search(const solution_t &solution,
 solution_t solve_local_search(solution_t solution,
                               solution_t::op_type_t op_type,
                               search_t search_type) {
+    scoped_phase_t phase(LOCAL_SEARCH);
     unsigned int path_size = solution.path.size();
     unsigned int neighbourhood_size =
         path_size * (path_size - 1) / 2 +
@@ -136,10 +135,11 @@ solution_t solve_local_search(solution_t solution,
     return solution;
 }
 
-solution_t solve_local_search(const tsp_t &tsp, unsigned int n,
-                              unsigned int start, solution_t::op_type_t op_type,
+solution_t solve_local_search(const tsp_t &tsp, const tables_t &tables,
+                              unsigned int n, unsigned int start,
+                              solution_t::op_type_t op_type,
                               search_t search_type) {
-    solution_t solution = solve_regret_weighted(tsp, n, start);
+    solution_t solution = solve_regret_weighted(tsp, tables, n, start);
     return solve_local_search(solution, op_type, search_type);
 }
 
@@ -147,59 +147,44 @@ std::vector<solution_t> solve_local_search(const tsp_t &tsp, unsigned int n,
                                            solution_t::op_type_t op_type,
                                            search_t search_type) {
     std::vector<solution_t> solutions = solve_random(tsp, n);
+    timer_t timer;
 
     for (unsigned int i = 0; i < solutions.size(); i++) {
-        const auto start = std::chrono::high_resolution_clock().now();
+        start_run(timer);
         solutions[i] = solve_local_search(solutions[i], op_type, search_type);
-        solutions[i].runtime_ms +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::high_resolution_clock().now() - start)
-                .count();
+        finish_run(solutions[i], timer);
     }
 
     return solutions;
 }
 
-solution_t solve_local_search_gen_greedy_swap(const tsp_t &tsp, unsigned int n,
+solution_t solve_local_search_gen_greedy_swap(const tsp_t &tsp,
+                                              const tables_t &tables,
+                                              unsigned int n,
                                               unsigned int start) {
-
-    return solve_local_search(tsp, n, start, solution_t::SWAP, GREEDY);
+    return solve_local_search(tsp, tables, n, start, solution_t::SWAP, GREEDY);
 }
 
 solution_t solve_local_search_gen_greedy_reverse(const tsp_t &tsp,
+                                                 const tables_t &tables,
                                                  unsigned int n,
                                                  unsigned int start) {
-    return solve_local_search(tsp, n, start, solution_t::REVERSE, GREEDY);
+    return solve_local_search(tsp, tables, n, start, solution_t::REVERSE,
+                              GREEDY);
 }
 
 solution_t solve_local_search_gen_steepest_swap(const tsp_t &tsp,
+                                                const tables_t &tables,
                                                 unsigned int n,
                                                 unsigned int start) {
-    return solve_local_search(tsp, n, start, solution_t::SWAP, STEEPEST);
+    return solve_local_search(tsp, tables, n, start, solution_t::SWAP,
+                              STEEPEST);
 }
 
 solution_t solve_local_search_gen_steepest_reverse(const tsp_t &tsp,
+                                                   const tables_t &tables,
                                                    unsigned int n,
                                                    unsigned int start) {
-    return solve_local_search(tsp, n, start, solution_t::REVERSE, STEEPEST);
-}
-
-std::vector<solution_t> solve_local_search_random_greedy_swap(const tsp_t &tsp,
-                                                              unsigned int n) {
-    return solve_local_search(tsp, n, solution_t::SWAP, GREEDY);
-}
-
-std::vector<solution_t>
-solve_local_search_random_greedy_reverse(const tsp_t &tsp, unsigned int n) {
-    return solve_local_search(tsp, n, solution_t::REVERSE, GREEDY);
-}
-
-std::vector<solution_t>
-solve_local_search_random_steepest_swap(const tsp_t &tsp, unsigned int n) {
-    return solve_local_search(tsp, n, solution_t::SWAP, STEEPEST);
-}
-
-std::vector<solution_t>
-solve_local_search_random_steepest_reverse(const tsp_t &tsp, unsigned int n) {
-    return solve_local_search(tsp, n, solution_t::REVERSE, STEEPEST);
+    return solve_local_search(tsp, tables, n, start, solution_t::REVERSE,
+                              STEEPEST);
 }
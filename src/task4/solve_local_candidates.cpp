@@ -1,3 +1,7 @@
+#pragma once
+
+#include "../common/parse.cpp"
+#include "../common/spatial.cpp"
 #include "../common/types.cpp"
 #include "../task1/solve_random.cpp"
 
@@ -5,37 +9,120 @@
 #include <chrono>
 #include <numeric>
 #include <optional>
+#include <span>
 #include <stdexcept>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
-typedef std::unordered_map<unsigned int, std::vector<unsigned int>> neighbors_t;
+// Candidate lists of every node as one flat n x k array, row i holding the
+// k nearest nodes j by d(i, j) + w(j), ties by index
+struct neighbors_t {
+    unsigned int k = 0;
+    std::vector<unsigned int> ids;
+
+    std::span<const unsigned int> at(unsigned int node) const {
+        return {ids.data() + size_t(node) * k, k};
+    }
+};
+
+// The `count` nearest nodes to i (as above) among those passing keep(j),
+// nearest first. The grid is walked ring by ring until no unvisited node
+// can beat the current count-th one: nodes beyond ring r - 1 lie at least
+// (r - 1) cell sizes away and weigh no less than the lightest node.
+template <typename keep_t>
+std::vector<std::pair<int, unsigned int>>
+grid_nearest(const tsp_t &tsp, const grid_index_t &grid, int min_weight,
+             unsigned int i, unsigned int count, keep_t &&keep) {
+    std::vector<std::pair<int, unsigned int>> best; // Max-heap
+    best.reserve(count + 1);
+    if (count == 0) {
+        return best;
+    }
 
-neighbors_t get_nearest_neighbors(const tsp_t &tsp, unsigned k) {
-    neighbors_t nn = {};
+    const node_t &node = tsp.nodes[i];
+    auto offer = [&](unsigned int j) {
+        if (j == i || !keep(j)) {
+            return;
+        }
+        std::pair<int, unsigned int> entry = {
+            l2(node, tsp.nodes[j]) + tsp.weights[j], j};
+        if (best.size() < count) {
+            best.push_back(entry);
+            std::push_heap(best.begin(), best.end());
+        } else if (entry < best.front()) {
+            std::pop_heap(best.begin(), best.end());
+            best.back() = entry;
+            std::push_heap(best.begin(), best.end());
+        }
+    };
+
+    int col = grid.col_of(node.x), row = grid.row_of(node.y);
+    for (int radius = 0;; radius++) {
+        if (best.size() == count && radius > 0) {
+            int bound = int((radius - 1) * grid.cell_size) - 1 + min_weight;
+            if (bound > best.front().first) {
+                break;
+            }
+        }
+        if (!grid.for_each_in_ring(col, row, radius, offer)) {
+            break;
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    return best;
+}
+
+// Candidate lists from a uniform grid over the nodes, about O(n k) for
+// evenly spread instances and without touching the distance matrix. With
+// `quadrants`, the list of i is split evenly between the four quadrants
+// around i (topped up with the nearest others where one runs short), so
+// candidates also lead out of dense clusters.
+neighbors_t get_nearest_neighbors(const tsp_t &tsp, unsigned int k,
+                                  bool quadrants = false) {
+    neighbors_t nn;
+    nn.k = std::min(k, tsp.n > 0 ? tsp.n - 1 : 0);
+    nn.ids.resize(size_t(tsp.n) * nn.k);
+    if (nn.k == 0) {
+        return nn;
+    }
+
+    grid_index_t grid(tsp.nodes);
+    int min_weight = *std::min_element(tsp.weights.begin(), tsp.weights.end());
+    auto all = [](unsigned int) { return true; };
 
     for (unsigned int i = 0; i < tsp.n; i++) {
-        nn[i] = std::vector<unsigned int>(tsp.n);
-        std::iota(nn[i].begin(), nn[i].end(), 0);
-        adj_list_t neighbors = tsp.adj_matrix[i];
-
-        std::transform(neighbors.cbegin(), neighbors.cend(),
-                       tsp.weights.cbegin(), neighbors.begin(),
-                       [](int dist, int weight) { return dist + weight; });
-        std::stable_sort(
-            nn[i].begin(), nn[i].end(),
-            [&neighbors](int a, int b) { return neighbors[a] < neighbors[b]; });
-
-        for (std::vector<unsigned int>::iterator it = nn[i].begin();
-             it != nn[i].end();) {
-            if (*it == i) {
-                it = nn[i].erase(it);
-            } else {
-                ++it;
+        std::vector<std::pair<int, unsigned int>> best;
+        if (!quadrants) {
+            best = grid_nearest(tsp, grid, min_weight, i, nn.k, all);
+        } else {
+            auto quadrant = [&](unsigned int j) -> unsigned int {
+                return (tsp.nodes[j].x < tsp.nodes[i].x) +
+                       2 * (tsp.nodes[j].y < tsp.nodes[i].y);
+            };
+            for (unsigned int q = 0; q < 4; q++) {
+                unsigned int share = nn.k / 4 + (q < nn.k % 4);
+                std::vector<std::pair<int, unsigned int>> part = grid_nearest(
+                    tsp, grid, min_weight, i, share,
+                    [&](unsigned int j) { return quadrant(j) == q; });
+                best.insert(best.end(), part.begin(), part.end());
+            }
+
+            for (const auto &entry :
+                 grid_nearest(tsp, grid, min_weight, i, nn.k, all)) {
+                if (best.size() == nn.k) {
+                    break;
+                }
+                if (std::find(best.begin(), best.end(), entry) == best.end()) {
+                    best.push_back(entry);
+                }
             }
+            std::sort(best.begin(), best.end());
         }
 
-        nn[i].erase(nn[i].begin() + k, nn[i].end());
+        for (unsigned int r = 0; r < nn.k; r++) {
+            nn.ids[size_t(i) * nn.k + r] = best[r].second;
+        }
     }
 
     return nn;
@@ -103,6 +190,7 @@ steepest_candidate_search(const solution_t &sol,
 
 solution_t local_candidates_steepest(const tsp_t &tsp, solution_t solution,
                                      const neighbors_t &neighbors_map) {
+    scoped_phase_t phase(LOCAL_SEARCH);
     while (true) {
         std::optional<operation_t> best_op =
             steepest_candidate_search(solution, neighbors_map);
@@ -133,18 +221,3 @@ solution_t local_candidates_steepest(const tsp_t &tsp, solution_t solution,
 
     return solution;
 }
-
-std::vector<solution_t> solve_local_candidates_steepest_random(const tsp_t &tsp,
-                                                               unsigned n) {
-    neighbors_t neighbors = get_nearest_neighbors(tsp, 10);
-    std::vector<solution_t> solutions = solve_random(tsp, n);
-    for (int i = 0; i < solutions.size(); i++) {
-        const auto start = std::chrono::high_resolution_clock().now();
-        solutions[i] = local_candidates_steepest(tsp, solutions[i], neighbors);
-        solutions[i].runtime_ms +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::high_resolution_clock().now() - start)
-                .count();
-    }
-    return solutions;
-}
@@ -270,11 +270,13 @@ steepest_deltas_search(const solution_t &solution, oper_queue_t &oper_pq,
          iter++) {
         edge_tracker_t::verdict_t verdict = edge_tracker.check(solution, *iter);
         if (verdict == edge_tracker_t::REMOVE) {
+            STAT(QUEUE_STALE);
             iters_to_remove.push(iter);
             continue;
         } else if (verdict == edge_tracker_t::LEAVE) {
             continue;
         } else if (verdict == edge_tracker_t::USE) {
+            STAT(QUEUE_HITS);
             best_op_info = *iter;
             iters_to_remove.push(iter);
             break;
@@ -294,6 +296,7 @@ steepest_deltas_search(const solution_t &solution, oper_queue_t &oper_pq,
 }
 
 solution_t local_deltas_steepest(const tsp_t &tsp, solution_t solution) {
+    scoped_phase_t phase(LOCAL_SEARCH);
     oper_queue_t oper_pq(solution);
     edge_tracker_t edge_tracker(solution);
 
@@ -332,17 +335,3 @@ solution_t local_deltas_steepest(const tsp_t &tsp, solution_t solution) {
 
     return solution;
 }
-
-std::vector<solution_t> solve_local_deltas_steepest_random(const tsp_t &tsp,
-                                                           unsigned n) {
-    std::vector<solution_t> solutions = solve_random(tsp, n);
-    for (int i = 0; i < solutions.size(); i++) {
-        const auto start = std::chrono::high_resolution_clock().now();
-        solutions[i] = local_deltas_steepest(tsp, solutions[i]);
-        solutions[i].runtime_ms +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::high_resolution_clock().now() - start)
-                .count();
-    }
-    return solutions;
-}
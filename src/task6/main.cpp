@@ -4,9 +4,10 @@
 #include <vector>
 
 #include "../common/parse.cpp"
-#include "../common/print.cpp"
+#include "../common/sink.cpp"
 #include "../common/types.cpp"
 #include "solve_local_iterated.cpp"
+#include "solve_local_multiple.cpp"
 
 int main() {
     std::ifstream fin("../../data/TSPA.csv");
@@ -20,13 +21,13 @@ int main() {
     for (unsigned i = 0; i < NUM_RUNS; i++) {
         timer.start();
         solution_t sol = local_search_multiple_start(tsp, PATH_SIZE);
-        sol.runtime_ms = timer.measure();
+        sol.runtime_ms = timer.measure_ms();
         solutions_msls.push_back(sol);
         std::cout << "MSLS " << i << ": " << sol.cost << "\n";
     }
     int avg_msls_duration =
-        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0,
-                        [](int val, const solution_t &sol) {
+        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0.0,
+                        [](double val, const solution_t &sol) {
                             return val + sol.runtime_ms;
                         }) /
         NUM_RUNS;
@@ -37,7 +38,7 @@ int main() {
         timer.start();
         solution_t iterated_sol =
             local_search_iterated(tsp, PATH_SIZE, avg_msls_duration);
-        iterated_sol.runtime_ms = timer.measure();
+        iterated_sol.runtime_ms = timer.measure_ms();
         solutions_iter.push_back(iterated_sol);
         std::cout << "Iterated " << i << ": " << iterated_sol.cost << "\n";
     }
@@ -1,16 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
 #include <vector>
 
+#include "../common/archive.cpp"
+#include "../common/checkpoint.cpp"
+#include "../common/convergence.cpp"
 #include "../common/random.cpp"
 #include "../common/types.cpp"
 #include "../task3/solve_local_search.cpp"
-#include "../task6/solve_local_multiple.cpp"
+
+#define ILS_ALTERATIONS 10u     // Perturbation strength
+#define ILS_MAX_ALTERATIONS 40u // Strength cap while stuck in known basins
+#define ILS_ARCHIVE 256         // Local optima remembered
 
 // Perturb the solution in-place
-void perturb_solution(solution_t &solution, unsigned int alterations = 10,
+void perturb_solution(solution_t &solution,
+                      unsigned int alterations = ILS_ALTERATIONS,
                       unsigned int max_shift = 15, double reverse_prob = 40,
                       double swap_prob = 80) {
+    scoped_phase_t phase(PERTURB);
     for (unsigned int i = 0; i < alterations; i++) {
         unsigned int idx1 = random_num(0, solution.path.size());
         unsigned int shift = random_num(0, max_shift + 1);
@@ -37,49 +47,44 @@ void perturb_solution(solution_t &solution, unsigned int alterations = 10,
 
 solution_t local_search_iterated(const tsp_t &tsp, unsigned int path_size,
                                  unsigned int time_limit_ms) {
-    int best_cost = INT_MAX;
-    solution_t solution = gen_random_solution(tsp, path_size);
+    total_cost_t best_cost = INT64_MAX;
+    solution_t solution =
+        warm_start_or([&] { return gen_random_solution(tsp, path_size); });
     solution_t best = solution;
+    archive_t visited(ILS_ARCHIVE);
+    unsigned int alterations = ILS_ALTERATIONS;
+    convergence_t trace;
     timer_t timer;
 
     timer.start();
     int i = 1;
     while (timer.measure() < time_limit_ms) {
         solution = solve_local_search(solution, solution_t::REVERSE, STEEPEST);
+        trace.record(i, solution.cost);
 
         if (solution.cost < best_cost) {
             best_cost = solution.cost;
             best = solution;
         }
+        checkpoint_best(best);
 
-        perturb_solution(solution);
+        // Back in a known basin: the last kick was too weak to leave it, so
+        // kick harder until a new local optimum turns up
+        archive_key_t key(solution);
+        std::optional<archive_match_t> known = visited.nearest(key);
+        if (known.has_value() && known->common_edges >= key.edges.size()) {
+            STAT(BASIN_REVISITS);
+            alterations = std::min(2 * alterations, ILS_MAX_ALTERATIONS);
+        } else {
+            visited.insert(std::move(key), solution.cost);
+            alterations = ILS_ALTERATIONS;
+        }
+
+        perturb_solution(solution, alterations);
         i++;
     }
 
     best.search_iters = i;
+    finish_trace(trace);
     return best;
 }
-
-std::vector<solution_t> solve_local_search_iterated(const tsp_t &tsp,
-                                                    unsigned int path_size) {
-    std::vector<solution_t> mslp_solutions =
-        solve_local_search_multiple_start(tsp, path_size);
-    int time_limit_ms =
-        std::accumulate(mslp_solutions.begin(), mslp_solutions.end(), 0,
-                        [](int val, const solution_t &sol) {
-                            return val + sol.runtime_ms;
-                        }) /
-        mslp_solutions.size();
-
-    std::vector<solution_t> solutions;
-    solutions.reserve(20);
-    timer_t timer;
-    for (unsigned int i = 0; i < 20; i++) {
-        timer.start();
-        solutions.push_back(
-            local_search_iterated(tsp, path_size, time_limit_ms));
-        solutions.back().runtime_ms = timer.measure();
-    }
-
-    return solutions;
-}
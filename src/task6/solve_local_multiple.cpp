@@ -14,17 +14,3 @@ solution_t local_search_multiple_start(const tsp_t &tsp, unsigned int n) {
               });
     return solutions[0];
 }
-
-std::vector<solution_t> solve_local_search_multiple_start(const tsp_t &tsp,
-                                                          unsigned int n) {
-    std::vector<solution_t> solutions;
-    solutions.reserve(20);
-    timer_t timer;
-    for (unsigned int i = 0; i < 20; i++) {
-        timer.start();
-        solutions.push_back(local_search_multiple_start(tsp, n));
-        solutions.back().runtime_ms = timer.measure();
-        solutions.back().search_iters = tsp.n;
-    }
-    return solutions;
-}
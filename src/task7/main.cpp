@@ -4,7 +4,7 @@
 #include <vector>
 
 #include "../common/parse.cpp"
-#include "../common/print.cpp"
+#include "../common/sink.cpp"
 #include "../common/types.cpp"
 #include "../task6/solve_local_multiple.cpp"
 #include "solve_large_neighbors.cpp"
@@ -21,13 +21,13 @@ int main() {
     for (unsigned i = 0; i < NUM_RUNS; i++) {
         timer.start();
         solution_t sol = local_search_multiple_start(tsp, PATH_SIZE);
-        sol.runtime_ms = timer.measure();
+        sol.runtime_ms = timer.measure_ms();
         solutions_msls.push_back(sol);
         std::cout << "MSLS " << i << ": " << sol.cost << "\n";
     }
     int avg_msls_duration =
-        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0,
-                        [](int val, const solution_t &sol) {
+        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0.0,
+                        [](double val, const solution_t &sol) {
                             return val + sol.runtime_ms;
                         }) /
         NUM_RUNS;
@@ -41,7 +41,7 @@ int main() {
             timer.start();
             solution_t lns_sol = large_neighborhood_search(
                 tsp, PATH_SIZE, avg_msls_duration, true);
-            lns_sol.runtime_ms = timer.measure();
+            lns_sol.runtime_ms = timer.measure_ms();
             solutions_lns.push_back(lns_sol);
             std::cout << "LNS with ls_after_repair=" << ls_after_repair << " "
                       << i << ": " << lns_sol.cost << "\n";
@@ -1,87 +1,314 @@
 #pragma once
 
+#include "../common/checkpoint.cpp"
+#include "../common/convergence.cpp"
+#include "../common/parse.cpp"
 #include "../common/random.cpp"
+#include "../common/sampler.cpp"
+#include "../common/spatial.cpp"
 #include "../common/types.cpp"
 #include "../task1/solve_random.cpp"
 #include "../task2/solve_greedy_regret.cpp"
 #include "../task3/solve_local_search.cpp"
-#include "../task6/solve_local_multiple.cpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
-solution_t destroy_solution(solution_t sol) {
-    int num_nodes_to_remove = sol.path.size() * 0.25;
-    std::vector<int> weights = std::vector(sol.path.size(), 1);
+#define DESTROY_FRACTION 0.25 // Default share of the path destroyed
+#define ALNS_SEGMENT 50
+#define ALNS_REACTION 0.2
+#define ALNS_MIN_WEIGHT 0.05
+#define ALNS_SCORE_BEST 10.0
+#define ALNS_SCORE_CLOSE 1.0
 
-    for (int i = 0; i < num_nodes_to_remove; i++) {
-        int idx_to_remove = random_num(weights);
-        weights.erase(weights.begin() + idx_to_remove);
-        sol.remove(idx_to_remove);
+enum destroy_op_t {
+    DESTROY_RANDOM,
+    DESTROY_WORST,
+    DESTROY_CLUSTER,
+    DESTROY_SEGMENT,
+    DESTROY_SHAW,
+    DESTROY_OP_COUNT
+};
+
+// Instance-level data shared by the destroy operators of an LNS run
+struct destroy_ctx_t {
+    const tsp_t *tsp;
+    grid_index_t grid;
+    std::vector<int> pos;    // Scratch: path position of each node, else -1
+    std::vector<bool> taken; // Scratch: path positions already drawn
+
+    destroy_ctx_t(const tsp_t &tsp)
+        : tsp(&tsp), grid(tsp.nodes), pos(tsp.n, -1), taken(tsp.n, false) {}
+};
+
+// Remove k uniformly random positions. All are equally likely, so plain
+// rejection against the scratch flags does: k is a fraction of the path,
+// so a pick takes O(1) draws, and only the k flags set are cleared.
+std::vector<unsigned int> destroy_random(const solution_t &sol, unsigned k,
+                                         destroy_ctx_t &ctx) {
+    std::vector<unsigned int> positions;
+    positions.reserve(k);
+
+    while (positions.size() < k) {
+        unsigned int pos = random_num(0, sol.path.size());
+        if (!ctx.taken[pos]) {
+            ctx.taken[pos] = true;
+            positions.push_back(pos);
+        }
+    }
+
+    for (unsigned int pos : positions) {
+        ctx.taken[pos] = false;
+    }
+    return positions;
+}
+
+// Remove k positions drawn from the 2k nodes whose removal saves the most.
+// Finding them takes a remove delta per position, O(path) per call, as
+// much as solution_t::remove compacting the path afterwards.
+std::vector<unsigned int> destroy_worst(const solution_t &sol, unsigned k) {
+    std::vector<pos_delta_t> gains;
+    gains.reserve(sol.path.size());
+    for (unsigned int pos = 0; pos < sol.path.size(); pos++) {
+        gains.push_back({pos, sol.remove_delta(pos)});
+    }
+
+    unsigned int pool = std::min<unsigned int>(2 * k, gains.size());
+    std::nth_element(gains.begin(), gains.begin() + pool - 1, gains.end(),
+                     [](const pos_delta_t &a, const pos_delta_t &b) {
+                         return a.second < b.second;
+                     });
+
+    std::vector<unsigned int> positions;
+    positions.reserve(k);
+    for (unsigned int i = 0; i < k; i++) {
+        std::swap(gains[i], gains[random_num(i, pool)]);
+        positions.push_back(gains[i].first);
+    }
+
+    return positions;
+}
+
+// Remove the k path nodes spatially closest to a random path node. The
+// grid search visits about O(k) nodes, but mapping them back to path
+// positions takes a linear pass over the scratch buffer (set and reset),
+// O(path) like the remove that follows. Nothing keeps a position index
+// across the repair and local search, which move every node.
+std::vector<unsigned int> destroy_cluster(const solution_t &sol, unsigned k,
+                                          destroy_ctx_t &ctx) {
+    const tsp_t &tsp = *ctx.tsp;
+    std::vector<int> &pos = ctx.pos;
+    for (unsigned int i = 0; i < sol.path.size(); i++) {
+        pos[sol.path[i]] = i;
+    }
+
+    const node_t &seed = tsp.nodes[sol.path[random_num(0, sol.path.size())]];
+    int col = ctx.grid.col_of(seed.x), row = ctx.grid.row_of(seed.y);
+
+    std::vector<unsigned int> positions;
+    std::vector<unsigned int> ring;
+    positions.reserve(k);
+
+    for (int radius = 0; positions.size() < k; radius++) {
+        ring.clear();
+        bool inside = ctx.grid.for_each_in_ring(
+            col, row, radius, [&](unsigned int node) {
+                if (pos[node] >= 0) {
+                    ring.push_back(node);
+                }
+            });
+
+        if (!inside) {
+            break;
+        }
+
+        // Only the outermost ring can overshoot, take its closest nodes
+        unsigned int take =
+            std::min<unsigned int>(k - positions.size(), ring.size());
+        if (take < ring.size()) {
+            std::nth_element(ring.begin(), ring.begin() + take, ring.end(),
+                             [&](unsigned int a, unsigned int b) {
+                                 return l2(seed, tsp.nodes[a]) <
+                                        l2(seed, tsp.nodes[b]);
+                             });
+        }
+
+        for (unsigned int i = 0; i < take; i++) {
+            positions.push_back(pos[ring[i]]);
+        }
+    }
+
+    for (unsigned int node : sol.path) {
+        pos[node] = -1;
+    }
+    return positions;
+}
+
+// Remove k consecutive positions starting at a random one
+std::vector<unsigned int> destroy_segment(const solution_t &sol, unsigned k) {
+    std::vector<unsigned int> positions;
+    positions.reserve(k);
+
+    unsigned int pos = random_num(0, sol.path.size());
+    for (unsigned int i = 0; i < k; i++, pos = sol.next(pos)) {
+        positions.push_back(pos);
+    }
+
+    return positions;
+}
+
+// Remove the k path nodes most related to a random path node, where
+// relatedness combines distance and weight similarity (Shaw removal).
+// Scores every path node, O(path) per call: the weight term defeats a
+// spatial search.
+std::vector<unsigned int> destroy_shaw(const solution_t &sol, unsigned k) {
+    const tsp_t &tsp = *sol.tsp;
+    unsigned int seed = sol.path[random_num(0, sol.path.size())];
+
+    std::vector<pos_delta_t> relatedness;
+    relatedness.reserve(sol.path.size());
+    for (unsigned int pos = 0; pos < sol.path.size(); pos++) {
+        unsigned int node = sol.path[pos];
+        int score = node == seed ? 0
+                                 : tsp.adj_matrix(seed, node) +
+                                       std::abs(tsp.weights[seed] -
+                                                tsp.weights[node]);
+        relatedness.push_back({pos, score});
+    }
+
+    std::nth_element(relatedness.begin(), relatedness.begin() + k - 1,
+                     relatedness.end(),
+                     [](const pos_delta_t &a, const pos_delta_t &b) {
+                         return a.second < b.second;
+                     });
+
+    std::vector<unsigned int> positions;
+    positions.reserve(k);
+    for (unsigned int i = 0; i < k; i++) {
+        positions.push_back(relatedness[i].first);
+    }
+
+    return positions;
+}
+
+solution_t destroy_solution(solution_t sol, destroy_op_t op,
+                            destroy_ctx_t &ctx,
+                            double fraction = DESTROY_FRACTION) {
+    scoped_phase_t phase(DESTROY);
+    unsigned int k = sol.path.size() * fraction;
+    k = std::min<unsigned int>(k, sol.path.size() - 1);
+
+    if (k == 0) {
+        return sol;
+    }
+
+    switch (op) {
+    case DESTROY_RANDOM:
+        sol.remove(destroy_random(sol, k, ctx));
+        break;
+    case DESTROY_WORST:
+        sol.remove(destroy_worst(sol, k));
+        break;
+    case DESTROY_CLUSTER:
+        sol.remove(destroy_cluster(sol, k, ctx));
+        break;
+    case DESTROY_SEGMENT:
+        sol.remove(destroy_segment(sol, k));
+        break;
+    case DESTROY_SHAW:
+        sol.remove(destroy_shaw(sol, k));
+        break;
+    default:
+        throw std::logic_error("Invalid destroy operator");
     }
 
     return sol;
 }
 
-solution_t large_neighborhood_search(const tsp_t &tsp, unsigned int path_size,
-                                     unsigned int time_limit_ms, bool ls) {
-    solution_t solution = solve_local_search(
-        gen_random_solution(tsp, path_size), solution_t::REVERSE, STEEPEST);
+// Adaptive (ALNS) roulette over the destroy operators. Operators collect
+// scores for the solutions they lead to and their selection weights are
+// re-estimated every ALNS_SEGMENT iterations.
+struct destroy_portfolio_t {
+    weighted_sampler_t weights;
+    std::vector<double> scores;
+    std::vector<unsigned int> uses;
+    unsigned int segment_iters;
+
+    destroy_portfolio_t()
+        : weights(DESTROY_OP_COUNT), scores(DESTROY_OP_COUNT, 0.0),
+          uses(DESTROY_OP_COUNT, 0), segment_iters(0) {}
+
+    destroy_op_t select() const { return destroy_op_t(weights.sample()); }
+
+    void reward(destroy_op_t op, double score) {
+        scores[op] += score;
+        uses[op]++;
+
+        if (++segment_iters < ALNS_SEGMENT) {
+            return;
+        }
+
+        for (unsigned int i = 0; i < DESTROY_OP_COUNT; i++) {
+            double weight = weights.weights[i];
+            if (uses[i] > 0) {
+                weight = (1 - ALNS_REACTION) * weight +
+                         ALNS_REACTION * scores[i] / uses[i];
+            }
+            weights.update(i, std::max(weight, ALNS_MIN_WEIGHT));
+            scores[i] = 0;
+            uses[i] = 0;
+        }
+        segment_iters = 0;
+    }
+};
+
+solution_t
+large_neighborhood_search(const tsp_t &tsp, unsigned int path_size,
+                          unsigned int time_limit_ms, bool ls,
+                          double destroy_fraction = DESTROY_FRACTION) {
+    solution_t solution = warm_start_or([&] {
+        return solve_local_search(gen_random_solution(tsp, path_size),
+                                  solution_t::REVERSE, STEEPEST);
+    });
     solution_t best = solution;
+    destroy_ctx_t ctx(tsp);
+    destroy_portfolio_t portfolio;
+    convergence_t trace;
     timer_t timer;
     int i = 1;
 
+    trace.record(0, solution.cost);
     timer.start();
     while (timer.measure() < time_limit_ms) {
-        solution = destroy_solution(best); // Destroy solution
-        solution =
-            solve_regret(solution, path_size, REGRET_WEIGHT); // Repair solution
+        destroy_op_t op = portfolio.select();
+        solution = destroy_solution(best, op, ctx, destroy_fraction);
+        {
+            scoped_phase_t phase(REPAIR);
+            solution = solve_regret(solution, path_size, REGRET_WEIGHT);
+        }
 
         if (ls) {
             solution =
                 solve_local_search(solution, solution_t::REVERSE, STEEPEST);
         }
+        trace.record(i, solution.cost);
 
         if (solution.cost < best.cost) {
+            portfolio.reward(op, ALNS_SCORE_BEST);
             best = solution;
+        } else if (solution.cost <= best.cost * 1.01) {
+            portfolio.reward(op, ALNS_SCORE_CLOSE);
+        } else {
+            portfolio.reward(op, 0);
         }
+        checkpoint_best(best);
 
         i++;
     }
 
     best.search_iters = i;
+    finish_trace(trace);
     return best;
 }
-
-std::vector<solution_t> solve_large_neighborhood_search(const tsp_t &tsp,
-                                                        unsigned int path_size,
-                                                        bool ls_after_repair) {
-    std::vector<solution_t> mslp_solutions =
-        solve_local_search_multiple_start(tsp, path_size);
-    int time_limit_ms =
-        std::accumulate(mslp_solutions.begin(), mslp_solutions.end(), 0,
-                        [](int val, const solution_t &sol) {
-                            return val + sol.runtime_ms;
-                        }) /
-        mslp_solutions.size();
-
-    std::vector<solution_t> solutions;
-    solutions.reserve(20);
-    timer_t timer;
-    for (unsigned int i = 0; i < 20; i++) {
-        timer.start();
-        solutions.push_back(large_neighborhood_search(
-            tsp, path_size, time_limit_ms, ls_after_repair));
-        solutions.back().runtime_ms = timer.measure();
-    }
-    return solutions;
-}
-
-std::vector<solution_t>
-solve_large_neighborhood_search_ls(const tsp_t &tsp, unsigned int path_size) {
-    return solve_large_neighborhood_search(tsp, path_size, true);
-}
-
-std::vector<solution_t>
-solve_large_neighborhood_search_nols(const tsp_t &tsp, unsigned int path_size) {
-    return solve_large_neighborhood_search(tsp, path_size, false);
-}
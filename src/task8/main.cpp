@@ -10,30 +10,24 @@
 
 void save_similarities(const std::vector<solution_t> &sols,
                        unsigned best_sol_idx, std::string filepath) {
+    std::cout << "Calculating similarities of " << sols.size()
+              << " solutions\n";
+    std::vector<similarity_key_t> keys(sols.begin(), sols.end());
+    similarity_sums_t sums = similarity_sums(keys);
+
     std::ofstream fout(filepath);
     fout << "cost,num_common_edges,num_common_nodes,avg_common_edges,avg_"
             "common_nodes\n";
+    double denominator = static_cast<double>(sols.size() - 1);
     for (unsigned i = 0; i < sols.size(); i++) {
-        if (i % 100 == 0)
-            std::cout << "Calculating similarities for solution " << i << "\n";
-        // if (i == best_sol_idx)
-        //     continue;
         unsigned common_edges_with_best =
-            common_edges_similarity(sols[i], sols[best_sol_idx]);
+            common_edges_similarity(keys[i], keys[best_sol_idx]);
         unsigned common_nodes_with_best =
-            common_nodes_similarity(sols[i], sols[best_sol_idx]);
+            common_nodes_similarity(keys[i], keys[best_sol_idx]);
 
-        double common_edges_sum = 0, common_nodes_sum = 0;
-        for (unsigned j = 0; j < sols.size(); j++) {
-            if (j == i)
-                continue;
-            common_edges_sum += common_edges_similarity(sols[i], sols[j]);
-            common_nodes_sum += common_nodes_similarity(sols[i], sols[j]);
-        }
-        double denominator = static_cast<double>(sols.size() - 1);
         fout << sols[i].cost << "," << common_edges_with_best << ","
-             << common_nodes_with_best << "," << common_edges_sum / denominator
-             << "," << common_nodes_sum / denominator << "\n";
+             << common_nodes_with_best << "," << sums.edges[i] / denominator
+             << "," << sums.nodes[i] / denominator << "\n";
     }
 }
 
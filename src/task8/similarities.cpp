@@ -1,7 +1,13 @@
 #pragma once
 
+#include "../common/edges.cpp"
 #include "../common/types.cpp"
+
+#include <bit>
+#include <cstdint>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 // Calculates the number of common edges between two solutions
 unsigned common_edges_similarity(const solution_t &sol1,
@@ -39,3 +45,81 @@ unsigned common_nodes_similarity(const solution_t &sol1,
     }
     return num_common_nodes;
 }
+
+// Solution encoded once for the pairwise comparisons: its nodes as a
+// bitset and its edges as packed_edges
+struct similarity_key_t {
+    std::vector<uint64_t> nodes;
+    std::vector<uint64_t> edges;
+
+    similarity_key_t(const solution_t &sol)
+        : nodes((sol.tsp->n + 63) / 64, 0), edges(packed_edges(sol)) {
+        for (unsigned node : sol.path) {
+            nodes[node / 64] |= uint64_t(1) << (node % 64);
+        }
+    }
+};
+
+// Same as common_nodes_similarity, popcount of the intersection
+unsigned common_nodes_similarity(const similarity_key_t &key1,
+                                 const similarity_key_t &key2) {
+    unsigned num_common_nodes = 0;
+    for (unsigned i = 0; i < key1.nodes.size(); i++) {
+        num_common_nodes += std::popcount(key1.nodes[i] & key2.nodes[i]);
+    }
+    return num_common_nodes;
+}
+
+// Same as common_edges_similarity, merge of the sorted edge lists
+unsigned common_edges_similarity(const similarity_key_t &key1,
+                                 const similarity_key_t &key2) {
+    return common_edges(key1.edges, key2.edges);
+}
+
+struct similarity_sums_t {
+    std::vector<uint64_t> edges; // By solution, over all the others
+    std::vector<uint64_t> nodes;
+};
+
+// Common edges and nodes of every solution summed over all the others.
+// Each pair is compared once; rows are dealt round-robin to the threads,
+// which keep their own sums, so the triangle is split evenly.
+similarity_sums_t similarity_sums(const std::vector<similarity_key_t> &keys,
+                                  unsigned threads = 0) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    unsigned n = keys.size();
+    std::vector<similarity_sums_t> partial(
+        threads, {std::vector<uint64_t>(n, 0), std::vector<uint64_t>(n, 0)});
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            similarity_sums_t &sums = partial[t];
+            for (unsigned i = t; i < n; i += threads) {
+                for (unsigned j = i + 1; j < n; j++) {
+                    unsigned edges = common_edges_similarity(keys[i], keys[j]);
+                    unsigned nodes = common_nodes_similarity(keys[i], keys[j]);
+                    sums.edges[i] += edges;
+                    sums.edges[j] += edges;
+                    sums.nodes[i] += nodes;
+                    sums.nodes[j] += nodes;
+                }
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    similarity_sums_t total = {std::vector<uint64_t>(n, 0),
+                               std::vector<uint64_t>(n, 0)};
+    for (const similarity_sums_t &sums : partial) {
+        for (unsigned i = 0; i < n; i++) {
+            total.edges[i] += sums.edges[i];
+            total.nodes[i] += sums.nodes[i];
+        }
+    }
+    return total;
+}
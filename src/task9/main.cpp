@@ -1,5 +1,5 @@
 #include "../common/parse.cpp"
-#include "../common/print.cpp"
+#include "../common/sink.cpp"
 #include "../common/types.cpp"
 #include "../task6/solve_local_multiple.cpp"
 
@@ -19,13 +19,13 @@ int main() {
     for (unsigned i = 0; i < NUM_RUNS; i++) {
         timer.start();
         solution_t sol = local_search_multiple_start(tsp, PATH_SIZE);
-        sol.runtime_ms = timer.measure();
+        sol.runtime_ms = timer.measure_ms();
         solutions_msls.push_back(sol);
         std::cout << "MSLS " << i << ": " << sol.cost << "\n";
     }
     int avg_msls_duration =
-        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0,
-                        [](int val, const solution_t &sol) {
+        std::accumulate(solutions_msls.cbegin(), solutions_msls.cend(), 0.0,
+                        [](double val, const solution_t &sol) {
                             return val + sol.runtime_ms;
                         }) /
         NUM_RUNS;
@@ -45,7 +45,7 @@ int main() {
                 solution_t evo_sol = solve_hybrid_evolutionary(
                     tsp, PATH_SIZE, 20, recomb_oper.first, ls_after_repair,
                     avg_msls_duration);
-                evo_sol.runtime_ms = timer.measure();
+                evo_sol.runtime_ms = timer.measure_ms();
                 solutions_lns.push_back(evo_sol);
                 std::cout << "HAE(" << recomb_oper.second
                           << ", ls_after_repair=" << ls_after_repair << ") "
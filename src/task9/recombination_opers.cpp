@@ -1,14 +1,12 @@
 #pragma once
 
 #include "../common/random.cpp"
+#include "../common/search.cpp"
 #include "../common/types.cpp"
 #include "../task2/solve_greedy_regret.cpp"
 
 #include <vector>
 
-auto rd = std::random_device();
-auto rng = std::default_random_engine(rd());
-
 std::vector<unsigned int> combine(const solution_t &left,
                                   const solution_t &right, bool fill) {
     auto edge_set = left.to_edges();
@@ -54,19 +52,22 @@ std::vector<unsigned int> combine(const solution_t &left,
 }
 
 solution_t random_fill_op(const solution_t &sol1, const solution_t &sol2) {
+    scoped_phase_t phase(RECOMBINE);
     return solution_t(*(sol1.tsp), combine(sol1, sol2, true));
 };
 
 solution_t heuristic_repair_op(const solution_t &sol1, const solution_t &sol2) {
+    scoped_phase_t phase(RECOMBINE);
     std::vector<unsigned> new_path = combine(sol1, sol2, false);
     if (new_path.size() == 0) {
-        new_path = find_cycle(*(sol1.tsp), random_num(0, 200));
+        new_path = find_cycle(*(sol1.tsp), random_num(0, sol1.tsp->n));
     } else if (new_path.size() < 3) {
         unsigned start_node = new_path[random_num(0, new_path.size())];
         new_path = find_cycle(*(sol1.tsp), start_node);
     }
 
     solution_t res_sol(*(sol1.tsp), new_path);
-    res_sol = solve_regret(res_sol, 100, 0.5);
+    scoped_phase_t repair_phase(REPAIR);
+    res_sol = solve_regret(res_sol, sol1.path.size(), 0.5);
     return res_sol;
 }
@@ -1,28 +1,37 @@
 #pragma once
 
+#include "../common/archive.cpp"
+#include "../common/checkpoint.cpp"
+#include "../common/convergence.cpp"
 #include "../common/random.cpp"
+#include "../common/sampler.cpp"
 #include "../common/types.cpp"
 #include "../task1/solve_random.cpp"
 #include "../task3/solve_local_search.cpp"
-#include "../task6/solve_local_multiple.cpp"
 #include "recombination_opers.cpp"
 
+#include <algorithm>
 #include <functional>
 #include <iterator>
+#include <optional>
 #include <set>
 #include <utility>
 #include <vector>
 
-std::pair<unsigned, unsigned> select_parents(std::vector<int> &weights) {
-    unsigned par1 = random_num(weights);
-    weights[par1] = 0;
-    unsigned par2 = random_num(weights);
-    weights[par1] = 1;
+#define HEA_TWIN_SIMILARITY 0.9 // Share of common edges making a twin
+
+// Draw two different individuals proportionally to their weights
+std::pair<unsigned, unsigned> select_parents(weighted_sampler_t &weights) {
+    unsigned par1 = weights.sample();
+    double par1_weight = weights.weights[par1];
+    weights.remove(par1);
+    unsigned par2 = weights.sample();
+    weights.update(par1, par1_weight);
     return {par1, par2};
 }
 
 struct individual_t {
-    int cost;
+    total_cost_t cost;
     unsigned int idx;
 };
 
@@ -38,19 +47,27 @@ solution_t solve_hybrid_evolutionary(
     solution_t (*recomb_oper)(const solution_t &, const solution_t &),
     bool ls_after_recomb, unsigned time_limit_ms) {
     std::vector<solution_t> population;
-    std::vector<int> pop_weights(pop_size, 1);
-    std::unordered_set<unsigned int> pop_costs;
+    weighted_sampler_t pop_weights(pop_size);
+    std::unordered_set<total_cost_t> pop_costs;
     std::multiset<individual_t> cost_tracker;
+    archive_t archive(pop_size);
+    std::vector<unsigned int> archive_ids;
+    convergence_t trace;
 
     population.reserve(pop_size);
     pop_costs.reserve(pop_size);
 
+    // An interrupted run resumes with its best as the first individual
     for (unsigned i = 0; i < pop_size; i++) {
-        solution_t sol = gen_random_solution(tsp, path_size);
-        sol = solve_local_search(sol, solution_t::REVERSE, STEEPEST);
+        solution_t sol = warm_start_or([&] {
+            return solve_local_search(gen_random_solution(tsp, path_size),
+                                      solution_t::REVERSE, STEEPEST);
+        });
         population.push_back(sol);
         pop_costs.insert(sol.cost);
         cost_tracker.insert({sol.cost, i});
+        archive_ids.push_back(archive.insert(archive_key_t(sol), sol.cost, i));
+        trace.record(0, sol.cost);
     }
 
     timer_t timer;
@@ -65,65 +82,48 @@ solution_t solve_hybrid_evolutionary(
         if (ls_after_recomb) {
             child = solve_local_search(child, solution_t::REVERSE, STEEPEST);
         }
+        trace.record(search_iters + 1, child.cost);
+
+        // Replace worst solution in population if better. A child that
+        // nearly repeats a member competes with that member instead, so
+        // one basin cannot take over the population.
+        auto [target_cost, target] = *cost_tracker.cbegin();
+        STAT(CHILDREN);
+
+        std::optional<archive_key_t> child_key;
+        if (child.cost < target_cost) {
+            child_key.emplace(child);
+            std::optional<archive_match_t> twin = archive.nearest(*child_key);
+            if (twin.has_value() &&
+                twin->common_edges >= HEA_TWIN_SIMILARITY * path_size) {
+                target = archive[twin->id].tag;
+                target_cost = population[target].cost;
+            }
+        }
 
-        // Replace worst solution in population if better
-        auto [worst_cost, worst_idx] = *cost_tracker.cbegin();
-
-        if (child.cost < worst_cost &&
+        if (child.cost < target_cost &&
             pop_costs.find(child.cost) == pop_costs.end()) {
-            population[worst_idx] = child;
-            pop_costs.erase(worst_cost);
+            STAT(CHILDREN_ACCEPTED);
+            population[target] = child;
+            pop_costs.erase(target_cost);
             pop_costs.insert(child.cost);
-            cost_tracker.erase(*cost_tracker.begin());
-            cost_tracker.insert({child.cost, worst_idx});
+            auto [first, last] = cost_tracker.equal_range({target_cost, 0});
+            cost_tracker.erase(
+                std::find_if(first, last, [&](const individual_t &member) {
+                    return member.idx == target;
+                }));
+            cost_tracker.insert({child.cost, target});
+            archive.remove(archive_ids[target]);
+            archive_ids[target] =
+                archive.insert(std::move(*child_key), child.cost, target);
         }
+        checkpoint_best(population[cost_tracker.rbegin()->idx]);
 
         search_iters++;
     }
 
     solution_t res_sol = population[(*cost_tracker.rbegin()).idx];
     res_sol.search_iters = search_iters;
+    finish_trace(trace);
     return res_sol;
 }
-
-std::vector<solution_t> solve_hybrid_evolutionary(
-    const tsp_t &tsp, unsigned int path_size,
-    solution_t (*recomb_oper)(const solution_t &, const solution_t &),
-    bool ls_after_recomb) {
-    std::vector<solution_t> mslp_solutions =
-        solve_local_search_multiple_start(tsp, path_size);
-    int time_limit_ms =
-        std::accumulate(mslp_solutions.begin(), mslp_solutions.end(), 0,
-                        [](int val, const solution_t &sol) {
-                            return val + sol.runtime_ms;
-                        }) /
-        mslp_solutions.size();
-
-    std::vector<solution_t> solutions;
-    solutions.reserve(20);
-    timer_t timer;
-    for (unsigned i = 0; i < 20; i++) {
-        timer.start();
-        solutions.push_back(solve_hybrid_evolutionary(
-            tsp, path_size, 20, recomb_oper, ls_after_recomb, time_limit_ms));
-        solutions.back().runtime_ms = timer.measure();
-    }
-    return solutions;
-}
-
-std::vector<solution_t> solve_hybrid_evolutionary_fill(const tsp_t &tsp,
-                                                       unsigned int path_size) {
-    return solve_hybrid_evolutionary(tsp, path_size, random_fill_op, false);
-}
-
-std::vector<solution_t>
-solve_hybrid_evolutionary_repair_no_ls(const tsp_t &tsp,
-                                       unsigned int path_size) {
-    return solve_hybrid_evolutionary(tsp, path_size, heuristic_repair_op,
-                                     false);
-}
-
-std::vector<solution_t>
-solve_hybrid_evolutionary_repair_ls(const tsp_t &tsp, unsigned int path_size) {
-    return solve_hybrid_evolutionary(tsp, path_size, heuristic_repair_op, true);
-}